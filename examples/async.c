@@ -0,0 +1,87 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/async.h"
+
+#include <stdint.h>
+
+/*
+ * Simulated remote call which takes 20us to complete: with one request in
+ * flight throughput is bound by latency, with 16 it is ~16 times higher.
+ * Batching 8 requests per call makes 8 times fewer calls for about the
+ * same throughput and latency, as long as batches fill up quickly.
+ */
+
+#define REMOTE_NS 20000
+#define BATCH 8
+
+static void reply(void *arg) { b63_async_complete((b63_async_op *)arg); }
+
+static void call(b63_async_op *op) {
+  b63_async_post_after(op->loop, REMOTE_NS, reply, op);
+}
+
+B63_ASYNC_BASELINE(sequential, i, 1) { call(b63_op); }
+
+B63_ASYNC_BENCHMARK(pipelined, i, 16) { call(b63_op); }
+
+/*
+ * Requests are held until BATCH of them are ready, then sent at once.
+ * When the loop has nothing else to do, partial batch is sent as well.
+ * Every batch has at least one of 16 operations in flight, so there are
+ * never more than 16 batches.
+ */
+typedef struct {
+  b63_async_op *ops[BATCH];
+  int size;
+} batch_t;
+
+static batch_t batches[16];
+static int next_batch = 0;
+static batch_t *pending = NULL;
+
+static void reply_batch(void *arg) {
+  batch_t *batch = (batch_t *)arg;
+  for (int k = 0; k < batch->size; k++) {
+    b63_async_complete(batch->ops[k]);
+  }
+}
+
+static void send(void *loop) {
+  if (pending != NULL) {
+    b63_async_post_after((b63_async_loop *)loop, REMOTE_NS, reply_batch,
+                         pending);
+    pending = NULL;
+  }
+}
+
+B63_ASYNC_BENCHMARK(batched, i, 16) {
+  b63_async_set_poll(b63_op->loop, send, b63_op->loop);
+  if (pending == NULL) {
+    pending = &batches[next_batch++ % 16];
+    pending->size = 0;
+  }
+  pending->ops[pending->size++] = b63_op;
+  if (pending->size == BATCH) {
+    send(b63_op->loop);
+  }
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
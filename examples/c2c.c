@@ -0,0 +1,28 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/c2c.h"
+
+/*
+ * Core-to-core latency and bandwidth for every pair of cpus, for example:
+ * ./_build/bm_c2c --cpus=0-7
+ * Run on an otherwise idle machine.
+ */
+
+int main(int argc, char **argv) {
+  return b63_c2c_main(argc, argv);
+}
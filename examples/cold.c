@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Lookups in a sorted array. Run with --cache=cold, --cache=llc-only
+ * and --tlb=cold to see the cost of first touch, compared to default
+ * warm mode. The array is built again for every epoch, so registered
+ * regions follow fixture rebuilds.
+ */
+
+#define COLD_SIZE (1 << 22)
+
+typedef struct {
+  int32_t *data;
+} sorted_t;
+
+B63_FIXTURE_SEEDED(sorted, sorted_t) {
+  sorted->data = (int32_t *)malloc(COLD_SIZE * sizeof(int32_t));
+  for (int32_t i = 0; i < COLD_SIZE; i++) {
+    sorted->data[i] = 2 * i + (int32_t)(b63_seed & 1);
+  }
+  /* flushed precisely in --cache=cold mode */
+  b63_cache_register(sorted->data, COLD_SIZE * sizeof(int32_t));
+}
+
+B63_TEARDOWN(sorted) { free(sorted->data); }
+
+B63_BENCHMARK_F(binary_search, sorted, n) {
+  int64_t res = 0;
+  uint64_t key = b63_seed;
+  for (uint64_t i = 0; i < n; i++) {
+    key = key * 6364136223846793005ULL + 1442695040888963407ULL;
+    int32_t target = (int32_t)((key >> 33) % (2 * COLD_SIZE));
+    int32_t lo = 0, hi = COLD_SIZE;
+    while (lo < hi) {
+      int32_t mid = lo + (hi - lo) / 2;
+      if (sorted->data[mid] < target) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    res += lo;
+  }
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/async.hpp"
+#include "../include/b63/b63.h"
+
+#include <cstdint>
+
+/*
+ * Coroutine bodies (C++20): every operation is a request making two
+ * dependent 10us calls through a callback-based client. At depth 1 a
+ * request takes 20us and throughput is bound by it; at depth 8 latency
+ * stays the same and throughput is 8 times higher.
+ */
+
+#define REMOTE_NS 10000
+
+/* C client: on_reply(arg) is called by the event loop when reply comes */
+static void client_send(b63_async_loop *loop, void (*on_reply)(void *),
+                        void *arg) {
+  b63_async_post_after(loop, REMOTE_NS, on_reply, arg);
+}
+
+static auto remote_call(b63_async_op *op) {
+  return b63::suspend(op, [op](b63::resumer r) {
+    client_send(op->loop, b63::resumer::callback, r.address());
+  });
+}
+
+B63_CORO_BASELINE(two_calls, i, 1) {
+  co_await remote_call(b63_op);
+  co_await remote_call(b63_op);
+}
+
+B63_CORO_BENCHMARK(two_calls_depth8, i, 8) {
+  co_await remote_call(b63_op);
+  co_await remote_call(b63_op);
+}
+
+/* the same, with the client replaced by the loop's own timer */
+B63_CORO_BENCHMARK(sleep_depth8, i, 8) {
+  co_await b63::sleep_for(b63_op, REMOTE_NS);
+  co_await b63::sleep_for(b63_op, REMOTE_NS);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+/*
+ * C++ API: bodies are lambdas, inlined into the batch loop. They run in
+ * the same suite as benchmarks defined with B63_BENCHMARK.
+ */
+
+const size_t kSize = (1 << 10);
+
+static int sum_reg = b63::baseline("sum", [](b63::state &s) {
+  std::vector<uint32_t> v(kSize);
+  s.suspend([&] { std::iota(v.begin(), v.end(), 0); });
+  uint32_t res = 0;
+  for (auto _ : s) {
+    for (size_t j = 0; j < kSize; j++) {
+      res += v[j];
+    }
+  }
+  b63::keep(res);
+});
+
+static int sum_indirect_reg = b63::benchmark("sum_indirect", [](b63::state &s) {
+  std::vector<uint32_t> v(kSize);
+  s.suspend([&] { std::iota(v.begin(), v.end(), 0); });
+  s.set_items(kSize);
+  uint32_t res = 0;
+  for (auto _ : s) {
+    for (size_t j = 0; j < kSize; j++) {
+      res += v[v[j]];
+    }
+  }
+  b63::keep(res);
+});
+
+/* benchmarks defined with C macros are part of the same suite */
+B63_BENCHMARK(sum_macro, n) {
+  std::vector<uint32_t> v;
+  B63_SUSPEND {
+    v.resize(kSize);
+    std::iota(v.begin(), v.end(), 0);
+  }
+  uint32_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < kSize; j++) {
+      res += v[j];
+    }
+  }
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
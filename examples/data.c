@@ -0,0 +1,73 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Sorting inputs with different distributions. Datasets are generated once
+ * per seed with b63/data.h and cached; every batch sorts a fresh copy.
+ */
+
+#define kSize (1 << 16)
+
+static int cmp_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+static void sort_dataset(b63_epoch *b63run, uint64_t n, int64_t b63_seed,
+                         int kind, int64_t range, double a) {
+  uint64_t *v = NULL;
+  B63_SUSPEND { v = (uint64_t *)malloc(kSize * sizeof(uint64_t)); }
+  for (uint64_t i = 0; i < n; i++) {
+    B63_SUSPEND {
+      memcpy(v, b63_data_cached(kind, kSize, b63_seed, range, a, 0),
+             kSize * sizeof(uint64_t));
+    }
+    qsort(v, kSize, sizeof(uint64_t), cmp_u64);
+  }
+  B63_KEEP(v[0]);
+  B63_SUSPEND { free(v); }
+}
+
+B63_BASELINE(uniform, n) {
+  sort_dataset(b63run, n, b63_seed, B63_DATA_UNIFORM, 1000000000, 0);
+}
+
+B63_BENCHMARK(zipf, n) {
+  sort_dataset(b63run, n, b63_seed, B63_DATA_ZIPF, 1000000000, 0.99);
+}
+
+B63_BENCHMARK(sorted, n) {
+  sort_dataset(b63run, n, b63_seed, B63_DATA_SORTED, 1000000000, 0);
+}
+
+B63_BENCHMARK(nearly_sorted, n) {
+  sort_dataset(b63run, n, b63_seed, B63_DATA_NEARLY_SORTED, 1000000000, 0.01);
+}
+
+B63_BENCHMARK(few_unique, n) {
+  sort_dataset(b63run, n, b63_seed, B63_DATA_FEW_UNIQUE, 1000000000, 16);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/counters/perf_events.h"
+
+/*
+ * Command line tool for benchmarking external commands, for example:
+ *
+ * ./_build/b63 -i --exec-baseline='gzip -1 -c data > /dev/null' \
+ *              --exec='gzip -9 -c data > /dev/null' -c time,os:utime
+ *
+ * There are no benchmarks registered here, only --exec commands are run.
+ */
+int main(int argc, char **argv) {
+  B63_RUN_WITH("time,os:utime,os:stime", argc, argv);
+  return 0;
+}
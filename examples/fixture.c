@@ -0,0 +1,80 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Input is generated once for the whole suite and shared by benchmarks,
+ * instead of being rebuilt in B63_SUSPEND on every call.
+ */
+
+#define FIXTURE_SIZE (1 << 16)
+
+typedef struct {
+  int32_t *input;
+  int32_t *work;
+} array_t;
+
+B63_FIXTURE(arr, array_t) {
+  arr->input = (int32_t *)malloc(FIXTURE_SIZE * sizeof(int32_t));
+  arr->work = (int32_t *)malloc(FIXTURE_SIZE * sizeof(int32_t));
+  srand(b63_seed);
+  for (int i = 0; i < FIXTURE_SIZE; i++) {
+    arr->input[i] = rand();
+  }
+}
+
+B63_TEARDOWN(arr) {
+  free(arr->input);
+  free(arr->work);
+}
+
+/* sorting below modifies work copy, so it is restored before every batch */
+B63_RESET(arr) {
+  memcpy(arr->work, arr->input, FIXTURE_SIZE * sizeof(int32_t));
+}
+
+static int cmp(const void *a, const void *b) {
+  int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+  return (x > y) - (x < y);
+}
+
+B63_BASELINE_F(sum, arr, n) {
+  int64_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    for (int j = 0; j < FIXTURE_SIZE; j++) {
+      res += arr->input[j];
+    }
+  }
+  B63_KEEP(res);
+}
+
+/* first iteration sorts, others get already sorted input */
+B63_BENCHMARK_F(sort_once, arr, n) {
+  for (uint64_t i = 0; i < n; i++) {
+    qsort(arr->work, FIXTURE_SIZE, sizeof(int32_t), cmp);
+  }
+  B63_KEEP(arr->work[0]);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
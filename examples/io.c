@@ -0,0 +1,68 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <unistd.h>
+
+/*
+ * 4KB reads from a 64MB file: sequential and random through page cache,
+ * and random with O_DIRECT, bypassing it. With cold cache every batch starts
+ * with the file evicted, so buffered reads go to the device too; os:inblock
+ * shows how many blocks were actually read:
+ * ./_build/bm_io -i --io-cache=cold -c time,os:inblock
+ * Use --io-dir to put the file on the device of interest, /tmp is often
+ * tmpfs, which has neither page cache eviction nor O_DIRECT.
+ */
+
+#define FILE_SIZE (64 << 20)
+#define BLOCK 4096
+
+B63_IO_FILE_DIRECT(data, FILE_SIZE);
+
+static uint64_t state = 1;
+static int64_t position = 0;
+
+static off_t next_block(void) {
+  state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (off_t)((state >> 33) % (FILE_SIZE / BLOCK)) * BLOCK;
+}
+
+B63_IO_BASELINE(sequential, data) {
+  B63_SET_BYTES(b63run, BLOCK);
+  ssize_t res = pread(data->fd, data->buffer, BLOCK, position);
+  B63_KEEP(res);
+  position = (position + BLOCK) % FILE_SIZE;
+}
+
+B63_IO_BENCHMARK(random, data) {
+  B63_SET_BYTES(b63run, BLOCK);
+  ssize_t res = pread(data->fd, data->buffer, BLOCK, next_block());
+  B63_KEEP(res);
+}
+
+B63_IO_BENCHMARK(random_direct, data) {
+  B63_SET_BYTES(b63run, BLOCK);
+  int fd = data->direct_fd >= 0 ? data->direct_fd : data->fd;
+  ssize_t res = pread(fd, data->buffer, BLOCK, next_block());
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
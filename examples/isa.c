@@ -0,0 +1,52 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Same loop compiled for baseline ISA, AVX2 and AVX-512, to see the
+ * payoff of runtime dispatch before implementing it. Variants the CPU
+ * doesn't support are skipped.
+ */
+
+#define kSize (1 << 12)
+
+static float x[kSize], y[kSize];
+
+B63_BENCHMARK_ISA(saxpy, n, "default", "avx2,fma", "avx512f") {
+  const float a = 1.5f;
+  B63_SUSPEND {
+    srand(b63_seed);
+    for (uint32_t i = 0; i < kSize; i++) {
+      x[i] = (float)rand() / RAND_MAX;
+      y[i] = (float)rand() / RAND_MAX;
+    }
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    for (uint32_t j = 0; j < kSize; j++) {
+      y[j] = a * x[j] + y[j];
+    }
+  }
+  B63_KEEP(y[0]);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Appending to an array: with preallocated storage every append costs
+ * about the same, while growing the array on demand is cheap on average,
+ * but some appends have to copy the whole array, which shows up in the tail.
+ */
+
+#define LATENCY_ARRAY_SIZE (1 << 20)
+
+static int64_t *fixed = NULL;
+static int64_t fixed_size = 0;
+
+static int64_t *growing = NULL;
+static int64_t growing_size = 0, growing_capacity = 0;
+
+B63_LATENCY_BASELINE(preallocated) {
+  if (fixed == NULL) {
+    fixed = (int64_t *)malloc(LATENCY_ARRAY_SIZE * sizeof(int64_t));
+  }
+  if (fixed_size == LATENCY_ARRAY_SIZE) {
+    fixed_size = 0;
+  }
+  fixed[fixed_size++] = b63_seed;
+}
+
+B63_LATENCY_BENCHMARK(doubling) {
+  if (growing_size == LATENCY_ARRAY_SIZE) {
+    free(growing);
+    growing = NULL;
+    growing_size = growing_capacity = 0;
+  }
+  if (growing_size == growing_capacity) {
+    growing_capacity = growing_capacity == 0 ? 16 : 2 * growing_capacity;
+    growing = (int64_t *)realloc(growing, growing_capacity * sizeof(int64_t));
+  }
+  growing[growing_size++] = b63_seed;
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  free(fixed);
+  free(growing);
+  return 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+
+/*
+ * Request handler with ~1us service time and an occasional slow request,
+ * measured at offered loads around its capacity. In closed loop, a slow
+ * request only delays itself; in open loop, requests arriving meanwhile
+ * wait for it too, which is what p99 shows as load gets closer to the knee:
+ * ./_build/bm_load -i --load=50k,200k,500k,800k --arrivals=poisson
+ */
+
+static uint64_t state = 1;
+
+static uint64_t spin(uint64_t rounds) {
+  uint64_t x = state;
+  for (uint64_t i = 0; i < rounds; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return x;
+}
+
+B63_LATENCY_BASELINE(closed_loop) {
+  state = spin((state >> 33) % 100 == 0 ? 20000 : 400);
+}
+
+B63_LATENCY_BENCHMARK(handler) {
+  state = spin((state >> 33) % 100 == 0 ? 20000 : 400);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/mt.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * Shared counter incremented by 4 threads: a single atomic counter, the
+ * same under a mutex, and per-thread counters on separate cache lines.
+ * Rows are per iteration of the slowest thread.
+ */
+
+static int64_t shared;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+typedef struct {
+  int64_t value;
+  char pad[64 - sizeof(int64_t)];
+} padded_t;
+
+static padded_t counters[4];
+
+B63_BASELINE_MT(atomic, n, 4) {
+  for (uint64_t i = 0; i < n; i++) {
+    __atomic_fetch_add(&shared, 1, __ATOMIC_RELAXED);
+  }
+}
+
+B63_BENCHMARK_MT(mutex, n, 4) {
+  for (uint64_t i = 0; i < n; i++) {
+    pthread_mutex_lock(&lock);
+    shared++;
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+B63_BENCHMARK_MT(per_thread, n, 4) {
+  int64_t *c = &counters[b63_thread_index].value;
+  for (uint64_t i = 0; i < n; i++) {
+    __atomic_fetch_add(c, 1, __ATOMIC_RELAXED);
+  }
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/net.h"
+
+#include <stdint.h>
+#include <sys/uio.h>
+
+/*
+ * Streaming 64KB over loopback TCP with plain send, MSG_ZEROCOPY and as
+ * 16 messages of 4KB with one sendmmsg, all compared to plain send, and
+ * 4KB round trips through an echo peer over TCP, unix socket and sendmsg
+ * with a separate header. Zero copy falls back to a copy on loopback, so
+ * zerocopy_64k shows the cost of the MSG_ZEROCOPY path rather than savings
+ * from it:
+ * ./_build/bm_net -i
+ */
+
+#define STREAM (64 << 10)
+#define MESSAGE 4096
+#define HEADER 64
+#define BATCH 16
+
+B63_NET_PAIR(sink, B63_NET_TCP, B63_NET_SINK);
+B63_NET_PAIR(zerocopy_sink, B63_NET_TCP, B63_NET_SINK | B63_NET_ZEROCOPY);
+B63_NET_PAIR(tcp, B63_NET_TCP, B63_NET_ECHO);
+B63_NET_PAIR(uds, B63_NET_UNIX, B63_NET_ECHO);
+
+B63_NET_BASELINE(send_64k, sink) {
+  B63_SET_BYTES(b63run, STREAM);
+  b63_net_send(sink, STREAM);
+}
+
+B63_NET_BENCHMARK(zerocopy_64k, zerocopy_sink) {
+  B63_SET_BYTES(b63run, STREAM);
+  b63_net_send(zerocopy_sink, STREAM);
+}
+
+/*
+ * sendmmsg can send fewer messages than asked, and the last one of them
+ * partially on a stream socket; the rest is sent until everything is out.
+ * Returns 0 on success.
+ */
+static int sendmmsg_all(int fd, struct mmsghdr *msgs, int size) {
+  for (int sent = 0; sent < size;) {
+    int res = sendmmsg(fd, msgs + sent, size - sent, 0);
+    if (res <= 0) {
+      return -1;
+    }
+    struct mmsghdr *last = &msgs[sent + res - 1];
+    struct iovec *iov = last->msg_hdr.msg_iov;
+    if (last->msg_len < iov->iov_len &&
+        b63_net_send_all(fd, (char *)iov->iov_base + last->msg_len,
+                         iov->iov_len - last->msg_len, 0) != 0) {
+      return -1;
+    }
+    sent += res;
+  }
+  return 0;
+}
+
+B63_NET_BENCHMARK(sendmmsg_64k, sink) {
+  struct mmsghdr msgs[BATCH];
+  struct iovec iov[BATCH];
+  memset(msgs, 0, sizeof(msgs));
+  for (int i = 0; i < BATCH; i++) {
+    iov[i].iov_base = sink->buffer + i * MESSAGE;
+    iov[i].iov_len = MESSAGE;
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  B63_SET_BYTES(b63run, STREAM);
+  B63_SET_ITEMS(b63run, BATCH);
+  if (sendmmsg_all(sink->fd, msgs, BATCH) != 0) {
+    b63run->fail = 1;
+  }
+}
+
+B63_NET_BENCHMARK(roundtrip_tcp, tcp) {
+  B63_SET_BYTES(b63run, MESSAGE);
+  b63_net_send(tcp, MESSAGE);
+  b63_net_recv(tcp, MESSAGE);
+}
+
+B63_NET_BENCHMARK(roundtrip_uds, uds) {
+  B63_SET_BYTES(b63run, MESSAGE);
+  b63_net_send(uds, MESSAGE);
+  b63_net_recv(uds, MESSAGE);
+}
+
+B63_NET_BENCHMARK(roundtrip_sendmsg, tcp) {
+  char header[HEADER] = {0};
+  struct iovec iov[2] = {{header, HEADER}, {tcp->buffer, MESSAGE}};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  B63_SET_BYTES(b63run, HEADER + MESSAGE);
+  /* a partial send leaves the tail of the iovecs to send */
+  size_t left = HEADER + MESSAGE;
+  while (left > 0) {
+    ssize_t res = sendmsg(tcp->fd, &msg, MSG_NOSIGNAL);
+    if (res <= 0) {
+      b63run->fail = 1;
+      return;
+    }
+    left -= res;
+    while (res > 0 && (size_t)res >= msg.msg_iov->iov_len) {
+      res -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (res > 0) {
+      msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + res;
+      msg.msg_iov->iov_len -= res;
+    }
+  }
+  b63_net_recv(tcp, HEADER + MESSAGE);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Two ways to sum the same values: sequential scan over an array, which
+ * is mostly bound by memory bandwidth, and random lookups into a table
+ * that fits in last level cache, which suffer when someone else thrashes
+ * it. Run with, for example:
+ * ./_build/bm_noise -i --noise=llc-thrash:2,membw:2,smt-sibling:spin
+ */
+
+#define TABLE_SIZE (1 << 20)
+
+typedef struct {
+  uint32_t *table;
+  uint32_t *keys;
+} lookup_t;
+
+B63_FIXTURE(lookup, lookup_t) {
+  lookup->table = (uint32_t *)malloc(TABLE_SIZE * sizeof(uint32_t));
+  lookup->keys = (uint32_t *)malloc(TABLE_SIZE * sizeof(uint32_t));
+  for (uint32_t i = 0; i < TABLE_SIZE; i++) {
+    lookup->table[i] = i * 2654435761U;
+    lookup->keys[i] = (i * 2654435761U) % TABLE_SIZE;
+  }
+}
+
+B63_TEARDOWN(lookup) {
+  free(lookup->table);
+  free(lookup->keys);
+}
+
+B63_BASELINE_F(scan, lookup, n) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    sum += lookup->table[i % TABLE_SIZE];
+  }
+  B63_KEEP(sum);
+}
+
+B63_BENCHMARK_F(random_lookup, lookup, n) {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    sum += lookup->table[lookup->keys[i % TABLE_SIZE]];
+  }
+  B63_KEEP(sum);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
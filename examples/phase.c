@@ -0,0 +1,111 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A small pipeline: parse numbers from text, transform them and
+ * serialize back. Every stage is reported as separate row.
+ */
+
+#define PHASE_NUMBERS 64
+
+static void generate(char *buf, size_t size, int64_t seed) {
+  size_t len = 0;
+  srand(seed);
+  for (int i = 0; i < PHASE_NUMBERS; i++) {
+    len += snprintf(buf + len, size - len, "%d ", rand() % 100000);
+  }
+}
+
+B63_BASELINE(pipeline, n) {
+  char input[1024], output[1024];
+  long values[PHASE_NUMBERS];
+  int64_t res = 0;
+  B63_SUSPEND { generate(input, sizeof(input), b63_seed); }
+  for (uint64_t i = 0; i < n; i++) {
+    B63_PHASE("parse") {
+      char *p = input;
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        values[j] = strtol(p, &p, 10);
+      }
+    }
+    B63_PHASE("transform") {
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        values[j] = values[j] * values[j] % 1000003;
+      }
+    }
+    B63_PHASE("serialize") {
+      size_t len = 0;
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        len += snprintf(output + len, sizeof(output) - len, "%ld,", values[j]);
+      }
+      res += len;
+    }
+  }
+  B63_KEEP(res);
+  B63_KEEP(output);
+}
+
+/* same pipeline, serialization is done with a hand-written conversion */
+B63_BENCHMARK(fast_serialize, n) {
+  char input[1024], output[1024];
+  long values[PHASE_NUMBERS];
+  int64_t res = 0;
+  B63_SUSPEND { generate(input, sizeof(input), b63_seed); }
+  for (uint64_t i = 0; i < n; i++) {
+    B63_PHASE("parse") {
+      char *p = input;
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        values[j] = strtol(p, &p, 10);
+      }
+    }
+    B63_PHASE("transform") {
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        values[j] = values[j] * values[j] % 1000003;
+      }
+    }
+    B63_PHASE("serialize") {
+      size_t len = 0;
+      for (int j = 0; j < PHASE_NUMBERS; j++) {
+        char digits[24];
+        int d = 0;
+        long v = values[j];
+        do {
+          digits[d++] = '0' + v % 10;
+          v /= 10;
+        } while (v > 0);
+        while (d > 0) {
+          output[len++] = digits[--d];
+        }
+        output[len++] = ',';
+      }
+      res += len;
+    }
+  }
+  B63_KEEP(res);
+  B63_KEEP(output);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
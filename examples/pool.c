@@ -0,0 +1,64 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+
+/*
+ * Branchy code over short inputs. With a single input the branch predictor
+ * learns the whole pattern; with many inputs in random order it can't, as
+ * in production. Reported as branchy/1, branchy/16, ... and branchy/pool,
+ * the ratio between the largest pool and a single input.
+ */
+
+#define kInputSize 64
+
+typedef struct {
+  uint8_t data[kInputSize];
+} input_t;
+
+B63_INPUT_POOL(inputs, input_t, 1024) {
+  b63_rng rng;
+  b63_rng_seed(&rng, b63_seed);
+  for (int i = 0; i < kInputSize; i++) {
+    inputs->data[i] = b63_rng_next(&rng) & 0xff;
+  }
+}
+
+/* splits bytes into small and large ones, one branch per byte */
+B63_BENCHMARK_POOL(branchy, inputs, n) {
+  uint8_t lo[kInputSize] = {0}, hi[kInputSize] = {0};
+  int64_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    input_t *in = B63_INPUT_NEXT(inputs);
+    int lo_size = 0, hi_size = 0;
+    for (int j = 0; j < kInputSize; j++) {
+      if (in->data[j] < 128) {
+        lo[lo_size++] = in->data[j];
+      } else {
+        hi[hi_size++] = in->data[j];
+      }
+    }
+    res += lo[0] + hi[0] + lo_size;
+  }
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
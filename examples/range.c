@@ -0,0 +1,98 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Parameterized benchmarks: every value of 'size' is registered as
+ * separate benchmark, 'sum/1024', 'sum/4096', etc. After all sizes are done,
+ * complexity is estimated, O(N) for sum and O(log N) for binary search:
+ *
+ * $ ./_build/bm_range -i
+ * sum/1024                      time                : 75.203
+ * ...
+ * sum/BigO                      time                :  0.071 O(N) (rms 4.2%)
+ *
+ * Sizes could be overridden from command line, for example, -a 1000,1000000
+ */
+B63_BENCHMARK_RANGE(sum, n, size, 1 << 10, 1 << 22, 4) {
+  int32_t *v = NULL;
+  int64_t res = 0;
+  B63_SUSPEND {
+    v = (int32_t *)malloc(size * sizeof(int32_t));
+    for (int64_t i = 0; i < size; i++) {
+      v[i] = rand();
+    }
+  }
+  for (uint64_t j = 0; j < n; j++) {
+    for (int64_t i = 0; i < size; i++) {
+      res += v[i];
+    }
+  }
+  B63_KEEP(res);
+  B63_SUSPEND { free(v); }
+}
+
+B63_BENCHMARK_RANGE(binary_search, n, size, 1 << 10, 1 << 22, 4) {
+  int32_t *v = NULL;
+  int64_t res = 0;
+  B63_SUSPEND {
+    v = (int32_t *)malloc(size * sizeof(int32_t));
+    for (int64_t i = 0; i < size; i++) {
+      v[i] = 2 * i;
+    }
+  }
+  for (uint64_t j = 0; j < n; j++) {
+    int32_t needle = (int32_t)((j * 7919) % (2 * size));
+    int64_t lo = 0, hi = size;
+    while (lo < hi) {
+      int64_t mid = (lo + hi) / 2;
+      if (v[mid] < needle) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    res += lo;
+  }
+  B63_KEEP(res);
+  B63_SUSPEND { free(v); }
+}
+
+/* cartesian product, instances are named 'strided/<size>/<stride>' */
+B63_BENCHMARK_RANGE2(strided, n, size, 1 << 12, 1 << 20, 16, stride, 1, 16,
+                     4) {
+  int32_t *v = NULL;
+  int64_t res = 0;
+  B63_SUSPEND {
+    v = (int32_t *)calloc(size, sizeof(int32_t));
+  }
+  for (uint64_t j = 0; j < n; j++) {
+    for (int64_t i = 0; i < size; i += stride) {
+      res += v[i];
+    }
+  }
+  B63_KEEP(res);
+  B63_SUSPEND { free(v); }
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+#include "../include/b63/mt.h"
+
+#include <pthread.h>
+#include <stdint.h>
+
+/*
+ * Thread-count sweep: run with --scale=1,2,4 (or up to the number of cpus)
+ * to get speedup per thread count and fitted contention (sigma) and
+ * coherency (kappa). Work under a single mutex is serialized, counters on
+ * the same cache line pay for coherency, padded counters scale linearly.
+ * Baseline is not scaled and runs with a single thread.
+ */
+
+#define MAX_THREADS 64
+
+static int64_t shared;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int64_t packed[MAX_THREADS];
+
+typedef struct {
+  int64_t value;
+  char pad[64 - sizeof(int64_t)];
+} padded_t;
+
+static padded_t padded[MAX_THREADS];
+
+static uint64_t work(uint64_t x) {
+  for (int i = 0; i < 16; i++) {
+    x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+  }
+  return x;
+}
+
+B63_BASELINE_MT(single, n, 1) {
+  uint64_t x = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    x = work(x + i);
+  }
+  B63_KEEP(x);
+}
+
+B63_BENCHMARK_MT(locked, n, 4) {
+  uint64_t x = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    x = work(x + i);
+    pthread_mutex_lock(&lock);
+    shared += x & 1;
+    pthread_mutex_unlock(&lock);
+  }
+}
+
+B63_BENCHMARK_MT(packed, n, 4) {
+  int64_t *c = &packed[b63_thread_index % MAX_THREADS];
+  uint64_t x = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    x = work(x + i);
+    __atomic_fetch_add(c, x & 1, __ATOMIC_RELAXED);
+  }
+}
+
+B63_BENCHMARK_MT(padded, n, 4) {
+  int64_t *c = &padded[b63_thread_index % MAX_THREADS].value;
+  uint64_t x = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    x = work(x + i);
+    __atomic_fetch_add(c, x & 1, __ATOMIC_RELAXED);
+  }
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
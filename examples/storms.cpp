@@ -1,4 +1,4 @@
-#include "../include/b63/b63.h"
+#include "../include/b63/b63.hpp"
 #include "../include/b63/counters/osx_kperf.h"
 
 #include <algorithm>
@@ -83,42 +83,27 @@ struct Test {
 
 const size_t kSize = (1 << 10);
 
-#define BM_UNROLLED(name, qos, unroll)     \
-  B63_BENCHMARK(name##_u##unroll, n) {     \
-    pthread_set_qos_class_self_np(qos, 0); \
-    Test* t;                               \
-    B63_SUSPEND {                          \
-      t = new Test(kSize, n);              \
-    }                                      \
-    int64_t res = t->run2<unroll>();        \
-    B63_KEEP(res);                         \
-    B63_SUSPEND {                          \
-      delete t;                            \
-    }                                      \
-  }
-
-#define FIRESTORM_UNROLLED(unroll)         \
-  BM_UNROLLED(firestorm, QOS_CLASS_USER_INTERACTIVE, unroll)
-#define ICESTORM_UNROLLED(unroll)          \
-  BM_UNROLLED(icestorm, QOS_CLASS_BACKGROUND, unroll)
-
-FIRESTORM_UNROLLED(1)
-FIRESTORM_UNROLLED(2)
-FIRESTORM_UNROLLED(4)
-FIRESTORM_UNROLLED(8)
-FIRESTORM_UNROLLED(16)
-FIRESTORM_UNROLLED(32)
-FIRESTORM_UNROLLED(64)
-FIRESTORM_UNROLLED(128)
+/* cores are selected with QoS class */
+struct firestorm {
+  static constexpr qos_class_t qos = QOS_CLASS_USER_INTERACTIVE;
+};
+struct icestorm {
+  static constexpr qos_class_t qos = QOS_CLASS_BACKGROUND;
+};
 
-ICESTORM_UNROLLED(1)
-ICESTORM_UNROLLED(2)
-ICESTORM_UNROLLED(4)
-ICESTORM_UNROLLED(8)
-ICESTORM_UNROLLED(16)
-ICESTORM_UNROLLED(32)
-ICESTORM_UNROLLED(64)
-ICESTORM_UNROLLED(128)
+B63_TEMPLATE_BENCHMARK(unrolled, n, (firestorm, icestorm),
+                       (1, 2, 4, 8, 16, 32, 64, 128)) {
+  pthread_set_qos_class_self_np(T::qos, 0);
+  Test* t;
+  B63_SUSPEND {
+    t = new Test(kSize, n);
+  }
+  int64_t res = t->run2<V>();
+  B63_KEEP(res);
+  B63_SUSPEND {
+    delete t;
+  }
+}
 
 int main(int argc, char **argv) {
   srand(time(0));
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <vector>
+
+/*
+ * Benchmark families over types and constants, each instance is reported
+ * separately. Both sum 1024 elements.
+ */
+
+/* type list can be empty, instances are named unrolled/1, unrolled/2, ... */
+B63_TEMPLATE_BASELINE(unrolled, n, (), (1, 2, 4, 8)) {
+  const uint32_t size = 1 << 10;
+  std::vector<uint32_t> v;
+  B63_SUSPEND { v.assign(size, 1); }
+  uint32_t res[V] = {0};
+  for (uint64_t i = 0; i < n; i++) {
+    for (uint32_t j = 0; j < size; j += V) {
+      for (uint32_t k = 0; k < V; k++) {
+        res[k] += v[j + k];
+      }
+    }
+  }
+  for (uint32_t k = 0; k < V; k++) {
+    B63_KEEP(res[k]);
+  }
+}
+
+using vector = std::vector<uint32_t>;
+using deque = std::deque<uint32_t>;
+using list = std::list<uint32_t>;
+
+/* sum/vector/1024, sum/deque/1024, sum/list/1024 */
+B63_TEMPLATE_BENCHMARK(sum, n, (vector, deque, list), (1024)) {
+  T container;
+  B63_SUSPEND {
+    for (uint32_t i = 0; i < V; i++) {
+      container.push_back(i);
+    }
+  }
+  uint32_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    for (auto v : container) {
+      res += v;
+    }
+  }
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
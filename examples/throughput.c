@@ -0,0 +1,97 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "../include/b63/b63.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Hashing buffers of different sizes: per-iteration time can't be compared
+ * directly, but throughput can.
+ */
+
+#define THROUGHPUT_MAX_SIZE (1 << 16)
+
+static uint64_t fnv1a(const uint8_t *data, size_t size) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ data[i]) * 1099511628211ULL;
+  }
+  return h;
+}
+
+/* processes 8 bytes at a time, not compatible with fnv1a, only faster */
+static uint64_t fnv1a_wide(const uint8_t *data, size_t size) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i + 8 <= size; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, 8);
+    h = (h ^ word) * 1099511628211ULL;
+  }
+  return h;
+}
+
+typedef struct {
+  uint8_t *data;
+} buffer_t;
+
+B63_FIXTURE(buf, buffer_t) {
+  buf->data = (uint8_t *)malloc(THROUGHPUT_MAX_SIZE);
+  srand(b63_seed);
+  for (int i = 0; i < THROUGHPUT_MAX_SIZE; i++) {
+    buf->data[i] = rand();
+  }
+}
+
+B63_TEARDOWN(buf) { free(buf->data); }
+
+B63_BASELINE_F(bytewise_4k, buf, n) {
+  const size_t size = 4096;
+  B63_SET_BYTES(b63run, size);
+  uint64_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    res += fnv1a(buf->data, size);
+  }
+  B63_KEEP(res);
+}
+
+B63_BENCHMARK_F(bytewise_64k, buf, n) {
+  const size_t size = THROUGHPUT_MAX_SIZE;
+  B63_SET_BYTES(b63run, size);
+  uint64_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    res += fnv1a(buf->data, size);
+  }
+  B63_KEEP(res);
+}
+
+B63_BENCHMARK_F(wide_64k, buf, n) {
+  const size_t size = THROUGHPUT_MAX_SIZE;
+  B63_SET_BYTES(b63run, size);
+  B63_SET_ITEMS(b63run, size / 8);
+  uint64_t res = 0;
+  for (uint64_t i = 0; i < n; i++) {
+    res += fnv1a_wide(buf->data, size);
+  }
+  B63_KEEP(res);
+}
+
+int main(int argc, char **argv) {
+  B63_RUN(argc, argv);
+  return 0;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_ASYNC_H_
+#define _B63_ASYNC_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "latency.h"
+#include "register.h"
+#include "utils/histogram.h"
+
+/*
+ * Asynchronous benchmarks: body starts a single operation, which completes
+ * later, when b63_async_complete is called for its handle, from a callback
+ * or a coroutine. The framework keeps 'depth' operations in flight:
+ *
+ * B63_ASYNC_BENCHMARK(get, i, 16) {
+ *   client_get(key(i), on_reply, b63_op);  -- on_reply calls
+ * }                                           b63_async_complete(b63_op)
+ *
+ * i is the index of the operation in the batch. Operations are driven by a
+ * minimal event loop on the benchmark thread: callbacks posted with
+ * b63_async_post run in order, b63_async_post_after runs them after a delay
+ * (spinning until then). If there is nothing to run and operations are
+ * still in flight, the poll function set with b63_async_set_poll is called,
+ * to drive an external event loop; without it, the epoch fails.
+ * b63_async_complete must be called on the benchmark thread.
+ *
+ * Counter values are per completed operation, so 1 / throughput for time;
+ * completions per second are reported as items. Latency of every operation,
+ * from start to completion, goes to the latency histogram and is reported
+ * as p50 .. max, the same way as for latency benchmarks.
+ *
+ * Coroutine adapter for C++20 is in async.hpp.
+ */
+
+typedef void (*b63_async_fn)(void *);
+
+typedef struct b63_async_task {
+  b63_async_fn fn;
+  void *arg;
+  /* clock ticks when the task is due, for delayed tasks */
+  int64_t due;
+} b63_async_task;
+
+typedef struct b63_async_op {
+  struct b63_async_loop *loop;
+  /* clock ticks when the operation was started */
+  int64_t started;
+  int32_t slot;
+  int8_t done;
+  /* free for the body to keep state of the operation */
+  void *data;
+} b63_async_op;
+
+typedef void (*b63_async_start_fn)(b63_async_op *, b63_epoch *, int64_t,
+                                   uint64_t);
+
+/* storage is preallocated per benchmark, nothing is allocated in the loop */
+typedef struct b63_async_loop {
+  b63_async_op *ops;
+  int32_t *free_slots;
+  int32_t free_size;
+  /* ring of ready tasks and binary heap of delayed ones */
+  b63_async_task *ready;
+  b63_async_task *delayed;
+  size_t ready_head, ready_size, delayed_size, capacity;
+  int64_t completed;
+  b63_histogram *histogram;
+  b63_async_fn poll;
+  void *poll_arg;
+  /* more tasks posted than capacity */
+  int8_t overflow;
+} b63_async_loop;
+
+/* task queue capacity for given depth */
+#define B63_ASYNC_TASKS(depth) (4 * (depth) + 1024)
+
+static void b63_async_post(b63_async_loop *loop, b63_async_fn fn, void *arg) {
+  if (loop->ready_size == loop->capacity) {
+    loop->overflow = 1;
+    return;
+  }
+  b63_async_task *t =
+      &loop->ready[(loop->ready_head + loop->ready_size) % loop->capacity];
+  t->fn = fn;
+  t->arg = arg;
+  t->due = 0;
+  loop->ready_size++;
+}
+
+static void b63_async_post_after(b63_async_loop *loop, int64_t ns,
+                                 b63_async_fn fn, void *arg) {
+  if (loop->delayed_size == loop->capacity) {
+    loop->overflow = 1;
+    return;
+  }
+  b63_async_task t = {fn, arg,
+                      b63_latency_now() +
+                          (int64_t)(ns / b63_latency_ns_per_tick())};
+  size_t i = loop->delayed_size++;
+  for (; i > 0 && loop->delayed[(i - 1) / 2].due > t.due; i = (i - 1) / 2) {
+    loop->delayed[i] = loop->delayed[(i - 1) / 2];
+  }
+  loop->delayed[i] = t;
+}
+
+static b63_async_task b63_async_pop_delayed(b63_async_loop *loop) {
+  b63_async_task top = loop->delayed[0];
+  b63_async_task last = loop->delayed[--loop->delayed_size];
+  size_t i = 0, size = loop->delayed_size;
+  for (;;) {
+    size_t c = 2 * i + 1;
+    if (c >= size) {
+      break;
+    }
+    if (c + 1 < size && loop->delayed[c + 1].due < loop->delayed[c].due) {
+      c++;
+    }
+    if (loop->delayed[c].due >= last.due) {
+      break;
+    }
+    loop->delayed[i] = loop->delayed[c];
+    i = c;
+  }
+  if (size > 0) {
+    loop->delayed[i] = last;
+  }
+  return top;
+}
+
+static void b63_async_set_poll(b63_async_loop *loop, b63_async_fn poll,
+                               void *arg) {
+  loop->poll = poll;
+  loop->poll_arg = arg;
+}
+
+/* marks operation done; its handle is reused for the next operation */
+static void b63_async_complete(b63_async_op *op) {
+  b63_async_loop *loop = op->loop;
+  if (op->done) {
+    fprintf(stderr, "async operation completed twice\n");
+    return;
+  }
+  op->done = 1;
+  b63_histogram_add(loop->histogram, b63_latency_now() - op->started);
+  loop->completed++;
+  loop->free_slots[loop->free_size++] = op->slot;
+}
+
+static void b63_async_loop_init(b63_async_loop *loop, b63_async_op *ops,
+                                int32_t *free_slots, int32_t depth,
+                                b63_async_task *ready, b63_async_task *delayed,
+                                b63_histogram *histogram) {
+  memset(loop, 0, sizeof(b63_async_loop));
+  loop->ops = ops;
+  loop->free_slots = free_slots;
+  for (int32_t i = 0; i < depth; i++) {
+    ops[i].loop = loop;
+    ops[i].slot = i;
+    free_slots[loop->free_size++] = depth - 1 - i;
+  }
+  loop->ready = ready;
+  loop->delayed = delayed;
+  loop->capacity = B63_ASYNC_TASKS(depth);
+  loop->histogram = histogram;
+}
+
+/* runs n operations, keeping as many in flight as there are free handles */
+static void b63_async_loop_run(b63_async_loop *loop, b63_epoch *e, uint64_t n,
+                               int64_t seed, b63_async_start_fn start) {
+  uint64_t started = 0;
+  while ((uint64_t)loop->completed < n) {
+    while (loop->free_size > 0 && started < n) {
+      b63_async_op *op = &loop->ops[loop->free_slots[--loop->free_size]];
+      op->done = 0;
+      op->data = NULL;
+      op->started = b63_latency_now();
+      start(op, e, seed, started++);
+    }
+    if (loop->ready_size > 0) {
+      b63_async_task t = loop->ready[loop->ready_head];
+      loop->ready_head = (loop->ready_head + 1) % loop->capacity;
+      loop->ready_size--;
+      t.fn(t.arg);
+    } else if (loop->delayed_size > 0) {
+      while (b63_latency_now() < loop->delayed[0].due) {
+      }
+      b63_async_task t = b63_async_pop_delayed(loop);
+      t.fn(t.arg);
+    } else if (loop->poll != NULL && (uint64_t)loop->completed < started) {
+      loop->poll(loop->poll_arg);
+    } else if ((uint64_t)loop->completed < started) {
+      fprintf(stderr, "%s: operations in flight, but nothing to run\n",
+              e->benchmark->name);
+      e->fail = 1;
+      return;
+    }
+    if (loop->overflow) {
+      fprintf(stderr, "%s: more than %zu tasks queued\n", e->benchmark->name,
+              loop->capacity);
+      e->fail = 1;
+      return;
+    }
+  }
+  e->items = 1;
+}
+
+#define B63_ASYNC_BENCHMARK_IMPL(bname, baseline, iters, ndepth)               \
+  static void b63_async_start_##bname(b63_async_op *, b63_epoch *, int64_t,    \
+                                      uint64_t);                               \
+  static b63_async_op b63_async_ops_##bname[ndepth];                           \
+  static int32_t b63_async_free_##bname[ndepth];                               \
+  static b63_async_task b63_async_ready_##bname[B63_ASYNC_TASKS(ndepth)];      \
+  static b63_async_task b63_async_delayed_##bname[B63_ASYNC_TASKS(ndepth)];    \
+  static void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {        \
+    b63_async_loop loop;                                                       \
+    b63_async_loop_init(&loop, b63_async_ops_##bname, b63_async_free_##bname,  \
+                        ndepth, b63_async_ready_##bname,                       \
+                        b63_async_delayed_##bname, e->histogram);              \
+    b63_async_loop_run(&loop, e, n, seed, b63_async_start_##bname);            \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = baseline,                                                 \
+      .failed = 0,                                                             \
+      .latency = 1,                                                            \
+      .depth = ndepth,                                                         \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  static void b63_async_start_##bname(b63_async_op *b63_op, b63_epoch *b63run, \
+                                      int64_t b63_seed, uint64_t iters)
+
+#define B63_ASYNC_BENCHMARK(name, iters, depth)                                \
+  B63_ASYNC_BENCHMARK_IMPL(name, 0, iters, depth)
+#define B63_ASYNC_BASELINE(name, iters, depth)                                 \
+  B63_ASYNC_BENCHMARK_IMPL(name, 1, iters, depth)
+
+#endif
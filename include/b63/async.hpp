@@ -0,0 +1,131 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_ASYNC_HPP_
+#define _B63_ASYNC_HPP_
+
+/*
+ * C++20 coroutine adapter for async benchmarks (async.h): body is a
+ * coroutine started for every operation, and the operation is complete
+ * when the coroutine returns:
+ *
+ * B63_CORO_BENCHMARK(get, i, 16) {
+ *   co_await b63::sleep_for(b63_op, 10000);  -- resumed by the event loop
+ *   co_await b63::suspend(b63_op, [&](b63::resumer r) {
+ *     client_get(key(i), [r] { r(); });      -- callback API
+ *   });
+ *   co_await b63::suspend(b63_op, [&](b63::resumer r) {
+ *     c_client_get(key(i), b63::resumer::callback, r.address());
+ *   });
+ * }
+ *
+ * Coroutines are resumed from the event loop only, so long chains of
+ * synchronous completions do not grow the stack. Coroutine frames are
+ * allocated with operator new, which is included in the measurement.
+ */
+
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+
+#include "async.h"
+
+namespace b63 {
+
+namespace detail {
+
+inline void resume(void *address) {
+  std::coroutine_handle<>::from_address(address).resume();
+}
+
+} // namespace detail
+
+/* return type of coroutine bodies; frame is destroyed when it returns */
+struct async_task {
+  struct promise_type {
+    b63_async_op *op;
+
+    template <class... Args>
+    explicit promise_type(b63_async_op *o, Args &&...) : op(o) {}
+
+    async_task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept { b63_async_complete(op); }
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+/* continues the coroutine later, from the event loop */
+struct resumer {
+  b63_async_op *op;
+  std::coroutine_handle<> handle;
+
+  void operator()() const {
+    b63_async_post(op->loop, detail::resume, handle.address());
+  }
+
+  /*
+   * For C callback APIs: pass callback and address() as its argument.
+   * Resumes right away, so the callback has to be called from the loop.
+   */
+  void *address() const { return handle.address(); }
+  static void callback(void *address) { detail::resume(address); }
+};
+
+/* suspends the coroutine, f gets a resumer to call on completion */
+template <class F> struct suspend_awaiter {
+  b63_async_op *op;
+  F f;
+
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(std::coroutine_handle<> h) { f(resumer{op, h}); }
+  void await_resume() const noexcept {}
+};
+
+template <class F> suspend_awaiter<F> suspend(b63_async_op *op, F &&f) {
+  return {op, std::forward<F>(f)};
+}
+
+/* lets other operations run, continues when the loop gets to it */
+inline auto yield(b63_async_op *op) {
+  return suspend(op, [](resumer r) { r(); });
+}
+
+/* continues after ns nanoseconds, for example to simulate remote calls */
+inline auto sleep_for(b63_async_op *op, int64_t ns) {
+  return suspend(op, [op, ns](resumer r) {
+    b63_async_post_after(op->loop, ns, detail::resume, r.handle.address());
+  });
+}
+
+} // namespace b63
+
+#define B63_CORO_BENCHMARK_IMPL(bname, baseline, iters, depth)                 \
+  static b63::async_task b63_coro_##bname(b63_async_op *, b63_epoch *,         \
+                                          int64_t, uint64_t);                  \
+  B63_ASYNC_BENCHMARK_IMPL(bname, baseline, iters, depth) {                    \
+    b63_coro_##bname(b63_op, b63run, b63_seed, iters);                         \
+  }                                                                            \
+  static b63::async_task b63_coro_##bname(                                     \
+      b63_async_op *b63_op, b63_epoch *b63run, int64_t b63_seed, uint64_t iters)
+
+#define B63_CORO_BENCHMARK(name, iters, depth)                                 \
+  B63_CORO_BENCHMARK_IMPL(name, 0, iters, depth)
+#define B63_CORO_BASELINE(name, iters, depth)                                  \
+  B63_CORO_BENCHMARK_IMPL(name, 1, iters, depth)
+
+#endif
@@ -0,0 +1,365 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_HPP_
+#define _B63_HPP_
+
+/*
+ * C++17 layer on top of the C library:
+ *
+ * #include "b63/b63.hpp"
+ *
+ * static int reg = b63::benchmark("sum", [](b63::state &s) {
+ *   int64_t res = 0;
+ *   for (auto _ : s) {
+ *     res += ...;
+ *   }
+ *   b63::keep(res);
+ * });
+ *
+ * The body is a template argument of the batch loop, so it's inlined
+ * there, instead of being called through b63_target_fn. Time counters are
+ * read directly as well, rather than through counter->type->read; other
+ * counters are read as usual. Benchmarks are registered at runtime, before
+ * B63_RUN, and are run in the same suite with the ones defined with
+ * B63_BENCHMARK, sharing baseline and printers.
+ */
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "b63.h"
+
+namespace b63 {
+
+/*
+ * Benchmark state passed to the body: range over iterations of the batch,
+ * and access to seed, suspension and throughput.
+ */
+class state {
+public:
+  state(b63_epoch *e, uint64_t n, int64_t seed) : e_(e), n_(n), seed_(seed) {}
+
+  /* non-trivial, so that 'for (auto _ : s)' isn't reported as unused */
+  struct value {
+    value() {}
+    ~value() {}
+  };
+
+  struct iterator {
+    uint64_t left;
+    bool operator!=(const iterator &) const { return left != 0; }
+    iterator &operator++() {
+      --left;
+      return *this;
+    }
+    value operator*() const { return value(); }
+  };
+
+  iterator begin() const { return iterator{n_}; }
+  iterator end() const { return iterator{0}; }
+
+  uint64_t iterations() const { return n_; }
+  int64_t seed() const { return seed_; }
+  b63_epoch *epoch() const { return e_; }
+
+  /* same as B63_SUSPEND: events during f() are not counted */
+  template <class F> void suspend(F &&f) {
+    b63_counter *c = e_->counter;
+    b63_suspension s = {c->type->read(c->impl), e_};
+    f();
+    b63_suspension_done(&s);
+  }
+
+  void set_bytes(int64_t bytes_per_iteration) {
+    B63_SET_BYTES(e_, bytes_per_iteration);
+  }
+  void set_items(int64_t items_per_iteration) {
+    B63_SET_ITEMS(e_, items_per_iteration);
+  }
+  /* same as B63_ASSERT */
+  void check(bool condition) {
+    if (!condition) {
+      e_->fail = 1;
+    }
+  }
+
+private:
+  b63_epoch *e_;
+  uint64_t n_;
+  int64_t seed_;
+};
+
+/* prevents compiler from optimizing out computation of v */
+template <class T> inline void keep(T &&v) {
+  __asm__ __volatile__("" ::"m"(v) : "memory");
+}
+
+namespace detail {
+
+/* counter readers, selected at runtime once per batch */
+struct generic_reader {
+  b63_counter *c;
+  int64_t read() const { return c->type->read(c->impl); }
+};
+
+#ifndef NO_GET_TIME_SUPPORTED
+struct clock_reader {
+  clockid_t clock;
+  int64_t read() const {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return 1000000000LL * (int64_t)ts.tv_sec + ts.tv_nsec;
+  }
+};
+#endif
+
+#ifdef B63_TSC_SUPPORTED
+struct tsc_reader {
+  const b63_counter_time *t;
+  int64_t read() const {
+    return (int64_t)((b63_tsc_read() - t->tsc_base) * t->ns_per_tick);
+  }
+};
+#endif
+
+/* storage for the body of every benchmark, one per lambda type */
+template <class F> struct body {
+  static std::unique_ptr<F> fn;
+};
+template <class F> std::unique_ptr<F> body<F>::fn;
+
+template <class F, class Reader>
+inline void measure_with(const Reader &r, b63_epoch *e, uint64_t n,
+                         int64_t seed, int64_t *started, int64_t *done) {
+  state s(e, n, seed);
+  F &f = *body<F>::fn;
+  *started = r.read();
+  e->phase_mark = *started;
+  f(s);
+  *done = r.read();
+}
+
+template <class F>
+void measure(b63_epoch *e, uint64_t n, int64_t seed, int64_t *started,
+             int64_t *done) {
+  b63_counter *c = e->counter;
+#ifndef NO_GET_TIME_SUPPORTED
+  if (c->type == &b63_ctype_time) {
+    const b63_counter_time *t = (const b63_counter_time *)c->impl;
+#ifdef B63_TSC_SUPPORTED
+    if (t->tsc) {
+      measure_with<F>(tsc_reader{t}, e, n, seed, started, done);
+      return;
+    }
+#endif
+    measure_with<F>(clock_reader{t->clock}, e, n, seed, started, done);
+    return;
+  }
+#endif
+  measure_with<F>(generic_reader{c}, e, n, seed, started, done);
+}
+
+/* used by calibration and anything calling b->run directly */
+template <class F> void run(b63_epoch *e, uint64_t n, int64_t seed) {
+  state s(e, n, seed);
+  (*body<F>::fn)(s);
+}
+
+/*
+ * Names and benchmark structs live until the end of the program. deque
+ * doesn't move elements on push_back, so name.c_str() stays valid.
+ */
+struct registration {
+  std::string name;
+  std::unique_ptr<b63_benchmark> benchmark;
+};
+
+inline std::deque<registration> &registrations() {
+  static std::deque<registration> res;
+  return res;
+}
+
+inline b63_benchmark *add_benchmark(std::string name, b63_target_fn run,
+                                    int8_t is_baseline) {
+  registration r;
+  r.name = std::move(name);
+  r.benchmark.reset(new b63_benchmark{nullptr, run, is_baseline});
+  registrations().push_back(std::move(r));
+  registration &last = registrations().back();
+  last.benchmark->name = last.name.c_str();
+  b63_register(last.benchmark.get());
+  return last.benchmark.get();
+}
+
+template <class F> int add(const char *name, F &&f, int8_t is_baseline) {
+  using fn_type = typename std::decay<F>::type;
+  body<fn_type>::fn.reset(new fn_type(std::forward<F>(f)));
+  add_benchmark(name, run<fn_type>, is_baseline)->measure = measure<fn_type>;
+  return 0;
+}
+
+/* Template benchmarks, see B63_TEMPLATE_BENCHMARK */
+template <class... Ts> struct type_list {};
+template <auto... Vs> struct value_list {};
+
+/*
+ * Splits stringified "(a, b<c, d>, e)" into {"a", "b<c, d>", "e"}, on
+ * top-level commas only. Angle brackets are only nested in type lists, as
+ * values can have '<<' or '>' operators.
+ */
+inline std::vector<std::string> split_list(const char *list, bool types) {
+  std::vector<std::string> res;
+  std::string curr;
+  int depth = 0;
+  for (const char *c = list; *c != '\0'; c++) {
+    if (*c == '(' || *c == '[' || *c == '{' || (types && *c == '<')) {
+      if (depth++ == 0) {
+        continue;
+      }
+    }
+    if (*c == ')' || *c == ']' || *c == '}' || (types && *c == '>')) {
+      if (--depth == 0) {
+        continue;
+      }
+    }
+    if (depth == 1 && *c == ',') {
+      res.push_back(curr);
+      curr.clear();
+      continue;
+    }
+    if (depth >= 1 && !(curr.empty() && *c == ' ')) {
+      curr += *c;
+    }
+  }
+  while (!curr.empty() && curr.back() == ' ') {
+    curr.pop_back();
+  }
+  if (!curr.empty() || !res.empty()) {
+    res.push_back(curr);
+  }
+  return res;
+}
+
+/* name/type/value, skipping empty lists */
+inline std::string template_name(const char *name,
+                                 const std::vector<std::string> &types,
+                                 size_t t,
+                                 const std::vector<std::string> &values,
+                                 size_t v) {
+  std::string res = name;
+  if (t < types.size()) {
+    res += "/" + types[t];
+  }
+  if (v < values.size()) {
+    res += "/" + values[v];
+  }
+  return res;
+}
+
+template <template <class, auto> class B, class T, auto... Vs>
+void add_template_type(const char *name, const std::vector<std::string> &types,
+                       size_t t, const std::vector<std::string> &values,
+                       int8_t *is_baseline) {
+  size_t v = 0;
+  ((add_benchmark(template_name(name, types, t, values, v++),
+                  B<T, Vs>::run, *is_baseline),
+    *is_baseline = 0),
+   ...);
+}
+
+template <template <class, auto> class B, class... Ts, auto... Vs>
+int add_template(const char *name, const char *type_names,
+                 const char *value_names, int8_t is_baseline,
+                 type_list<Ts...>, value_list<Vs...>) {
+  /* empty list is the same as a list with single unnamed element */
+  if constexpr (sizeof...(Ts) == 0) {
+    return add_template<B>(name, type_names, value_names, is_baseline,
+                           type_list<void>{}, value_list<Vs...>{});
+  } else if constexpr (sizeof...(Vs) == 0) {
+    return add_template<B>(name, type_names, value_names, is_baseline,
+                           type_list<Ts...>{}, value_list<0>{});
+  } else {
+    std::vector<std::string> types = split_list(type_names, true);
+    std::vector<std::string> values = split_list(value_names, false);
+    size_t t = 0;
+    (add_template_type<B, Ts, Vs...>(name, types, t++, values, &is_baseline),
+     ...);
+    return 0;
+  }
+}
+
+} // namespace detail
+
+/*
+ * Registers benchmark with body f(b63::state &). Every lambda has its own
+ * type, which is what makes the loop a separate, inlined instantiation;
+ * registering the same lambda object twice would replace the body.
+ */
+template <class F> int benchmark(const char *name, F &&f) {
+  return detail::add(name, std::forward<F>(f), 0);
+}
+
+template <class F> int baseline(const char *name, F &&f) {
+  return detail::add(name, std::forward<F>(f), 1);
+}
+
+} // namespace b63
+
+#define B63_UNPAREN(...) __VA_ARGS__
+
+/*
+ * Benchmark family, instantiated for every combination of types from the
+ * first list and constexpr values from the second one. In the body the
+ * current type is T and the value is V:
+ *
+ * B63_TEMPLATE_BENCHMARK(fill, n, (std::vector<int>, std::deque<int>),
+ *                        (16, 1024)) {
+ *   T container;
+ *   for (uint64_t i = 0; i < n; i++) {
+ *     container.resize(V);
+ *     ...
+ *   }
+ * }
+ *
+ * Instances are named name/type/value, for example fill/std::deque<int>/16;
+ * either list can be empty, (), and is omitted from the name then.
+ * B63_TEMPLATE_BASELINE makes the first instance a baseline.
+ */
+#define B63_TEMPLATE_BENCHMARK_IMPL(bname, baseline, iters, types, values)     \
+  template <class T, auto V> struct b63_template_##bname {                     \
+    static void run(b63_epoch *, uint64_t, int64_t);                           \
+  };                                                                           \
+  static int b63_template_reg_##bname = b63::detail::add_template<             \
+      b63_template_##bname>(                                                   \
+      #bname, #types, #values, baseline,                                       \
+      b63::detail::type_list<B63_UNPAREN types>{},                             \
+      b63::detail::value_list<B63_UNPAREN values>{});                          \
+  template <class T, auto V>                                                   \
+  void b63_template_##bname<T, V>::run(b63_epoch *b63run, uint64_t iters,      \
+                                       int64_t b63_seed)
+
+#define B63_TEMPLATE_BENCHMARK(name, iters, types, values)                     \
+  B63_TEMPLATE_BENCHMARK_IMPL(name, 0, iters, types, values)
+#define B63_TEMPLATE_BASELINE(name, iters, types, values)                      \
+  B63_TEMPLATE_BENCHMARK_IMPL(name, 1, iters, types, values)
+
+#endif
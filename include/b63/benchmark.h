@@ -14,8 +14,8 @@
  * limitations under the License.
  */
 
-#ifndef _B63_DATA_H_
-#define _B63_DATA_H_
+#ifndef _B63_BENCHMARK_H_
+#define _B63_BENCHMARK_H_
 
 #include "counter_list.h"
 
@@ -24,6 +24,14 @@ struct b63_benchmark;
 struct b63_sink;
 struct b63_suite;
 struct b63_counter;
+struct b63_histogram;
+struct b63_fixture;
+
+/* max number of named phases in a benchmark, see phase.h */
+#define B63_MAX_PHASES 8
+
+/* number of values reported for latency benchmarks: p50 .. p999, max */
+#define B63_LATENCY_VALUES 5
 
 /*
  * Epoch is a unit of benchmark execution which might consist
@@ -37,8 +45,42 @@ typedef struct b63_epoch {
   struct b63_counter *counter;
   int64_t iterations;
   int64_t events;
+  int64_t seed;
   int8_t suspension_done;
   int8_t fail;
+  /*
+   * Latency benchmarks only: histogram of operation latencies for the
+   * current epoch, operations left until next sample, and the results
+   * in nanoseconds.
+   */
+  struct b63_histogram *histogram;
+  int64_t latency_countdown;
+  double latency[B63_LATENCY_VALUES];
+  /*
+   * Open-loop latency benchmarks only: gaps between scheduled arrivals in
+   * clock ticks, NULL for closed loop, and clock ticks batches took.
+   */
+  const int64_t *arrivals;
+  int64_t load_ticks;
+  /*
+   * Events per phase, slot 0 is for events outside of any phase.
+   * Phase names are assigned in order of first entry within the epoch.
+   */
+  int64_t phase_events[B63_MAX_PHASES + 1];
+  const char *phase_names[B63_MAX_PHASES + 1];
+  int8_t phases_size;
+  /* current phase and counter value when it was entered */
+  int8_t phase;
+  int64_t phase_mark;
+  /* time spent on cache/TLB eviction between batches, not measured */
+  int64_t excluded_ns;
+  /* amount processed per iteration, if set; see throughput.h */
+  int64_t bytes, items;
+  /*
+   * Multithreaded benchmarks only: sums over batches of the smallest,
+   * total and largest per-thread counter values; see mt.h.
+   */
+  int64_t thread_min, thread_sum, thread_max;
 } b63_epoch;
 
 /*
@@ -47,6 +89,25 @@ typedef struct b63_epoch {
  */
 typedef void (*b63_target_fn)(struct b63_epoch *, uint64_t, int64_t);
 
+/*
+ * Optional replacement of 'read counter, run, read counter' for a batch,
+ * writing counter values before and after the run. Used by C++ layer to
+ * inline the counter reads, see b63.hpp.
+ */
+typedef void (*b63_measure_fn)(struct b63_epoch *, uint64_t, int64_t,
+                               int64_t *, int64_t *);
+
+/* max number of arguments of parameterized benchmark */
+#define B63_MAX_ARGS 2
+
+/*
+ * Range of argument values for parameterized benchmark:
+ * lo, lo * mult, lo * mult^2, ... up to and including hi.
+ */
+typedef struct b63_range {
+  int64_t lo, hi, mult;
+} b63_range;
+
 /*
  * This struct represents individual benchmark.
  */
@@ -61,8 +122,44 @@ typedef struct b63_benchmark {
   struct b63_suite *suite;
   /* [weak] pointer to current results. Used ONLY for baseline */
   b63_epoch *results;
+  int64_t results_size;
   /* if any run has failed; */
   int8_t failed;
+  /* framework times individual operations, see latency.h */
+  int8_t latency;
+  /* input shared across epochs and counters, NULL if none; see fixture.h */
+  struct b63_fixture *fixture;
+  /* external command to run, for --exec benchmarks; see exec.h */
+  const char *command;
+  /* target of B63_BENCHMARK_ISA variant, NULL otherwise; see isa.h */
+  const char *isa;
+  /* variant of the same B63_BENCHMARK_ISA the others are compared with */
+  struct b63_benchmark *isa_default;
+  /* position of the target in B63_BENCHMARK_ISA, 0 for isa_default */
+  int8_t isa_index;
+  /* if set, used instead of 'run' to measure a batch */
+  b63_measure_fn measure;
+  /* number of threads running the body at once, 0 if not multithreaded */
+  int32_t threads;
+  /* operations kept in flight by async benchmarks, 0 otherwise; async.h */
+  int32_t depth;
+  /*
+   * Parameterized benchmarks are registered as a 'family' with argument
+   * ranges, and instances with specific args are created at suite start.
+   */
+  int8_t args_size;
+  b63_range ranges[B63_MAX_ARGS];
+  int64_t args[B63_MAX_ARGS];
+  /* [weak] family this instance was created from, NULL if not an instance */
+  struct b63_benchmark *family;
+  /* mean rate from the last report, used for complexity fitting */
+  double mean;
+  /*
+   * Open-loop latency benchmarks: offered load in operations per second,
+   * 0 for closed loop; achieved load and p99 from the last report.
+   */
+  int64_t rate;
+  double achieved, p99;
 } b63_benchmark;
 
 #endif
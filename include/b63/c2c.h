@@ -0,0 +1,296 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_C2C_H_
+#define _B63_C2C_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+#include "mt.h"
+#include "utils/timer.h"
+
+/*
+ * Core-to-core probe: for every ordered pair of cpus (a, b), two threads
+ * pinned to them measure
+ *  - round-trip latency: a writes a cache line, b waits for it and writes
+ *    back, a waits for the answer; best of several samples, ns per round;
+ *  - one-way bandwidth: a fills a buffer, b reads all of it and
+ *    acknowledges; bytes per ns (GB/s), including a's writes and the
+ *    handshake, so it's what a producer/consumer pair could get.
+ *
+ * b63_c2c_probe fills cpu-by-cpu matrices, b63_c2c_print prints them with
+ * topology marks, b63_c2c_main is the ready to use entry point:
+ *
+ * int main(int argc, char **argv) {
+ *   return b63_c2c_main(argc, argv);
+ * }
+ *
+ * Requires -lpthread on older systems. Pairs sharing a cpu (or cpus which
+ * are not idle) make threads yield to each other and are not meaningful.
+ */
+
+/* lines are padded to two cache lines, adjacent line prefetch pairs them */
+#define B63_C2C_LINE 128
+#define B63_C2C_SAMPLES 8
+#define B63_C2C_ROUNDS 4096
+#define B63_C2C_BUFFER (64 * 1024)
+#define B63_C2C_TRANSFERS 64
+
+typedef struct b63_c2c_pair {
+  int cpu_a, cpu_b;
+  /* ping-pong line, and sequence/acknowledgement lines for the transfer */
+  int64_t *ping;
+  int64_t *seq;
+  int64_t *ack;
+  int64_t *buffer;
+  /* set by a: best ns per round trip, ns for all transfers */
+  double latency_ns;
+  double transfer_ns;
+  int8_t ok;
+  /* set by each thread if it is running on its cpu */
+  int8_t pinned_a;
+  int8_t pinned_b;
+} b63_c2c_pair;
+
+static void b63_c2c_wait(int64_t *v, int64_t expected) {
+  for (int64_t i = 0; __atomic_load_n(v, __ATOMIC_ACQUIRE) != expected; i++) {
+    if (i < (1 << 12)) {
+      b63_mt_pause();
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+static void *b63_c2c_responder(void *arg) {
+  b63_c2c_pair *p = (b63_c2c_pair *)arg;
+  /* protocol still has to run to completion, the pair fails afterwards */
+  p->pinned_b = b63_cpu_pin(p->cpu_b);
+  for (int64_t r = 0; r < B63_C2C_SAMPLES * B63_C2C_ROUNDS; r++) {
+    b63_c2c_wait(p->ping, 2 * r + 1);
+    __atomic_store_n(p->ping, 2 * r + 2, __ATOMIC_RELEASE);
+  }
+  int64_t sum = 0;
+  const size_t words = B63_C2C_BUFFER / sizeof(int64_t);
+  for (int64_t k = 1; k <= B63_C2C_TRANSFERS; k++) {
+    b63_c2c_wait(p->seq, k);
+    for (size_t w = 0; w < words; w++) {
+      sum += p->buffer[w];
+    }
+    __atomic_store_n(p->ack, k, __ATOMIC_RELEASE);
+  }
+  /* all words of k-th transfer are k */
+  p->ok = sum == (int64_t)words * B63_C2C_TRANSFERS * (B63_C2C_TRANSFERS + 1) / 2;
+  return NULL;
+}
+
+static void *b63_c2c_initiator(void *arg) {
+  b63_c2c_pair *p = (b63_c2c_pair *)arg;
+  p->pinned_a = b63_cpu_pin(p->cpu_a);
+  p->latency_ns = 0.0;
+  for (int64_t s = 0; s < B63_C2C_SAMPLES; s++) {
+    int64_t r = s * B63_C2C_ROUNDS;
+    int64_t started = b63_monotonic_ns();
+    for (; r < (s + 1) * B63_C2C_ROUNDS; r++) {
+      __atomic_store_n(p->ping, 2 * r + 1, __ATOMIC_RELEASE);
+      b63_c2c_wait(p->ping, 2 * r + 2);
+    }
+    double ns = 1.0 * (b63_monotonic_ns() - started) / B63_C2C_ROUNDS;
+    if (s == 0 || ns < p->latency_ns) {
+      p->latency_ns = ns;
+    }
+  }
+  const size_t words = B63_C2C_BUFFER / sizeof(int64_t);
+  int64_t started = b63_monotonic_ns();
+  for (int64_t k = 1; k <= B63_C2C_TRANSFERS; k++) {
+    for (size_t w = 0; w < words; w++) {
+      p->buffer[w] = k;
+    }
+    __atomic_store_n(p->seq, k, __ATOMIC_RELEASE);
+    b63_c2c_wait(p->ack, k);
+  }
+  p->transfer_ns = (double)(b63_monotonic_ns() - started);
+  return NULL;
+}
+
+/* measures one ordered pair, returns 0 on failure */
+static int8_t b63_c2c_measure(int cpu_a, int cpu_b, double *latency_ns,
+                              double *bandwidth) {
+  b63_c2c_pair p;
+  char *mem = NULL;
+  memset(&p, 0, sizeof(p));
+  if (posix_memalign((void **)&mem, B63_C2C_LINE,
+                     3 * B63_C2C_LINE + B63_C2C_BUFFER) != 0) {
+    fprintf(stderr, "memory allocation failed for c2c probe\n");
+    return 0;
+  }
+  memset(mem, 0, 3 * B63_C2C_LINE + B63_C2C_BUFFER);
+  p.cpu_a = cpu_a;
+  p.cpu_b = cpu_b;
+  p.ping = (int64_t *)mem;
+  p.seq = (int64_t *)(mem + B63_C2C_LINE);
+  p.ack = (int64_t *)(mem + 2 * B63_C2C_LINE);
+  p.buffer = (int64_t *)(mem + 3 * B63_C2C_LINE);
+
+  pthread_t a, b;
+  if (pthread_create(&b, NULL, b63_c2c_responder, &p) != 0) {
+    free(mem);
+    return 0;
+  }
+  if (pthread_create(&a, NULL, b63_c2c_initiator, &p) != 0) {
+    /* responder is waiting for the first ping, can't join it */
+    fprintf(stderr, "unable to start c2c probe thread\n");
+    exit(EXIT_FAILURE);
+  }
+  pthread_join(a, NULL);
+  pthread_join(b, NULL);
+  free(mem);
+  if (!p.ok || !p.pinned_a || !p.pinned_b || !(p.transfer_ns > 0.0)) {
+    return 0;
+  }
+  *latency_ns = p.latency_ns;
+  *bandwidth = 1.0 * B63_C2C_BUFFER * B63_C2C_TRANSFERS / p.transfer_ns;
+  return 1;
+}
+
+/*
+ * Fills size x size matrices, row is the initiating cpu and column the
+ * responding one. Diagonal and failed pairs are 0.
+ */
+static void b63_c2c_probe(const int *cpus, size_t size, double *latency_ns,
+                          double *bandwidth) {
+  for (size_t i = 0; i < size; i++) {
+    for (size_t j = 0; j < size; j++) {
+      latency_ns[i * size + j] = 0.0;
+      bandwidth[i * size + j] = 0.0;
+      if (i != j &&
+          !b63_c2c_measure(cpus[i], cpus[j], &latency_ns[i * size + j],
+                           &bandwidth[i * size + j])) {
+        fprintf(stderr, "c2c probe failed for cpus %d and %d\n", cpus[i],
+                cpus[j]);
+      }
+    }
+  }
+}
+
+/* '*' for SMT siblings, '+' for shared L3, '!' for different sockets */
+static char b63_c2c_mark(int a, int b) {
+  if (b63_cpu_core(a) == b63_cpu_core(b)) {
+    return '*';
+  }
+  if (b63_cpu_package(a) != b63_cpu_package(b)) {
+    return '!';
+  }
+  int l3 = b63_cpu_l3(a);
+  return l3 >= 0 && l3 == b63_cpu_l3(b) ? '+' : ' ';
+}
+
+static void b63_c2c_print_matrix(const char *title, const char *format,
+                                 const int *cpus, size_t size,
+                                 const double *m) {
+  printf("%s\n%6s", title, "");
+  for (size_t j = 0; j < size; j++) {
+    printf("%11d", cpus[j]);
+  }
+  printf("\n");
+  for (size_t i = 0; i < size; i++) {
+    printf("%6d", cpus[i]);
+    for (size_t j = 0; j < size; j++) {
+      if (i == j || !(m[i * size + j] > 0.0)) {
+        printf("%11s", "-");
+      } else {
+        printf(format, m[i * size + j]);
+        printf("%c", b63_c2c_mark(cpus[i], cpus[j]));
+      }
+    }
+    printf("\n");
+  }
+}
+
+static void b63_c2c_print(const int *cpus, size_t size,
+                          const double *latency_ns, const double *bandwidth) {
+  printf("%6s%8s%8s%8s\n", "cpu", "core", "l3", "socket");
+  for (size_t i = 0; i < size; i++) {
+    printf("%6d%8d%8d%8d\n", cpus[i], b63_cpu_core(cpus[i]),
+           b63_cpu_l3(cpus[i]), b63_cpu_package(cpus[i]));
+  }
+  printf("\n* SMT sibling, + shared L3, ! other socket\n\n");
+  b63_c2c_print_matrix("round trip, ns", "%10.1lf", cpus, size, latency_ns);
+  printf("\n");
+  b63_c2c_print_matrix("one-way bandwidth, GB/s", "%10.2lf", cpus, size,
+                       bandwidth);
+  fflush(stdout);
+}
+
+/*
+ * Probes cpus from --cpus=2,4,6-8, or all available ones, and prints the
+ * matrices. Returns exit code.
+ */
+static int b63_c2c_main(int argc, char **argv) {
+  int *cpus = NULL;
+  size_t size = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--cpus=", 7) == 0) {
+      free(cpus);
+      size = b63_cpu_list_parse(argv[i] + 7, &cpus);
+      if (size == 0) {
+        fprintf(stderr, "unable to parse cpu list: %s\n", argv[i] + 7);
+        return EXIT_FAILURE;
+      }
+    } else {
+      fprintf(stderr, "usage: %s [--cpus=0-3]\n", argv[0]);
+      free(cpus);
+      return EXIT_FAILURE;
+    }
+  }
+  if (cpus == NULL) {
+    size = b63_cpu_available(&cpus);
+  }
+  for (size_t i = 0; i < size; i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (cpus[i] == cpus[j]) {
+        fprintf(stderr, "cpu %d is listed more than once\n", cpus[i]);
+        free(cpus);
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if (size < 2) {
+    fprintf(stderr, "c2c probe needs at least two cpus\n");
+    free(cpus);
+    return EXIT_FAILURE;
+  }
+  double *latency_ns = (double *)malloc(size * size * sizeof(double));
+  double *bandwidth = (double *)malloc(size * size * sizeof(double));
+  if (latency_ns == NULL || bandwidth == NULL) {
+    fprintf(stderr, "memory allocation failed for c2c probe\n");
+    exit(EXIT_FAILURE);
+  }
+  b63_c2c_probe(cpus, size, latency_ns, bandwidth);
+  b63_c2c_print(cpus, size, latency_ns, bandwidth);
+  free(latency_ns);
+  free(bandwidth);
+  free(cpus);
+  return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_CACHE_H_
+#define _B63_CACHE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/*
+ * Cache and TLB state before measured batches (--cache, --tlb).
+ * By default everything is measured warm: after the first batch, data
+ * is in cache. Cold modes evict caches before each batch, outside of the
+ * measured region:
+ *  - cold: all cache levels. Buffers registered with b63_cache_register
+ *    are flushed with clflush (x86); if there are none, or clflush is not
+ *    available, a buffer of twice the last level cache size is read through;
+ *  - llc-only: data stays in last level cache, but not in L1/L2. Registered
+ *    buffers are read, then a buffer of twice L2 size is read through;
+ *  - tlb cold: one read per page over a region with more pages than TLB
+ *    has entries.
+ * Cache sizes come from /sys/devices/system/cpu/cpu0/cache.
+ */
+
+enum { B63_CACHE_WARM = 0, B63_CACHE_COLD, B63_CACHE_LLC_ONLY };
+
+#define B63_CACHE_LINE 64
+#define B63_CACHE_MAX_REGIONS 64
+/* used when sizes are not available from sysfs */
+#define B63_CACHE_DEFAULT_L2 (1LL << 20)
+#define B63_CACHE_DEFAULT_LLC (32LL << 20)
+/* 16K pages covers second level TLB of current CPUs */
+#define B63_TLB_PAGES (1LL << 14)
+#define B63_PAGE_SIZE 4096
+
+typedef struct b63_cache_region {
+  const char *data;
+  size_t size;
+  /* fixture which was being built when the region was registered */
+  const void *owner;
+} b63_cache_region;
+
+/* state for evictions, allocated once per suite */
+typedef struct b63_cache {
+  char *thrash;
+  size_t thrash_size;
+  char *pages;
+} b63_cache;
+
+/*
+ * Registered buffers are flushed precisely instead of relying on the
+ * thrash buffer only. Can be called from fixture setup; regions registered
+ * there are dropped when the fixture is released, before its teardown.
+ * Buffers freed elsewhere need b63_cache_unregister.
+ */
+static b63_cache_region b63_cache_regions[B63_CACHE_MAX_REGIONS];
+static size_t b63_cache_regions_size = 0;
+/* set by fixtures while they are built */
+static const void *b63_cache_owner = NULL;
+
+static void b63_cache_register(const void *data, size_t size) {
+  if (b63_cache_regions_size == B63_CACHE_MAX_REGIONS) {
+    fprintf(stderr, "too many cache regions registered\n");
+    return;
+  }
+  b63_cache_regions[b63_cache_regions_size].data = (const char *)data;
+  b63_cache_regions[b63_cache_regions_size].size = size;
+  b63_cache_regions[b63_cache_regions_size].owner = b63_cache_owner;
+  b63_cache_regions_size++;
+}
+
+/* removes regions starting at data, or registered by owner if not NULL */
+static void b63_cache_unregister_impl(const void *data, const void *owner) {
+  size_t kept = 0;
+  for (size_t i = 0; i < b63_cache_regions_size; i++) {
+    b63_cache_region *r = &b63_cache_regions[i];
+    if ((data != NULL && (const void *)r->data == data) ||
+        (owner != NULL && r->owner == owner)) {
+      continue;
+    }
+    b63_cache_regions[kept++] = *r;
+  }
+  b63_cache_regions_size = kept;
+}
+
+static void b63_cache_unregister(const void *data) {
+  b63_cache_unregister_impl(data, NULL);
+}
+
+/*
+ * Size in bytes of data/unified cache at 'level', or of the last level
+ * if level is 0. Returns 0 if not available.
+ */
+static int64_t b63_cache_size(int level) {
+  int64_t res = 0;
+  int best_level = 0;
+  char path[128], buf[64];
+  for (int i = 0;; i++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d",
+             i);
+    char file[160];
+    snprintf(file, sizeof(file), "%s/level", path);
+    FILE *f = fopen(file, "r");
+    if (f == NULL) {
+      break;
+    }
+    int l = 0;
+    if (fscanf(f, "%d", &l) != 1) {
+      l = 0;
+    }
+    fclose(f);
+
+    snprintf(file, sizeof(file), "%s/type", path);
+    f = fopen(file, "r");
+    if (f == NULL) {
+      continue;
+    }
+    if (fgets(buf, sizeof(buf), f) == NULL || strncmp(buf, "Instr", 5) == 0) {
+      fclose(f);
+      continue;
+    }
+    fclose(f);
+
+    snprintf(file, sizeof(file), "%s/size", path);
+    f = fopen(file, "r");
+    if (f == NULL) {
+      continue;
+    }
+    char *unit = NULL;
+    int64_t size = 0;
+    if (fgets(buf, sizeof(buf), f) != NULL) {
+      size = strtoll(buf, &unit, 10);
+      size *= *unit == 'K' ? 1024LL : *unit == 'M' ? 1024LL * 1024LL : 1LL;
+    }
+    fclose(f);
+    if ((level == 0 && l > best_level) || l == level) {
+      best_level = l;
+      res = size;
+    }
+  }
+  return res;
+}
+
+static b63_cache *b63_cache_create(int8_t mode, int8_t tlb) {
+  b63_cache *c = (b63_cache *)calloc(1, sizeof(b63_cache));
+  if (c == NULL) {
+    fprintf(stderr, "memory allocation failed for cache eviction\n");
+    exit(EXIT_FAILURE);
+  }
+  if (mode != B63_CACHE_WARM) {
+    int64_t size = b63_cache_size(mode == B63_CACHE_COLD ? 0 : 2);
+    if (size == 0) {
+      size = mode == B63_CACHE_COLD ? B63_CACHE_DEFAULT_LLC
+                                    : B63_CACHE_DEFAULT_L2;
+    }
+    c->thrash_size = 2 * size;
+    c->thrash = (char *)malloc(c->thrash_size);
+    if (c->thrash == NULL) {
+      fprintf(stderr, "memory allocation failed for cache eviction\n");
+      exit(EXIT_FAILURE);
+    }
+    /* distinct values, so pages are not deduplicated */
+    for (size_t i = 0; i < c->thrash_size; i += B63_CACHE_LINE) {
+      c->thrash[i] = (char)i;
+    }
+  }
+  if (tlb) {
+    size_t pages_size = B63_TLB_PAGES * B63_PAGE_SIZE;
+    c->pages = (char *)mmap(NULL, pages_size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (c->pages == MAP_FAILED) {
+      fprintf(stderr, "memory allocation failed for tlb eviction\n");
+      exit(EXIT_FAILURE);
+    }
+#ifdef MADV_NOHUGEPAGE
+    /* every page needs its own tlb entry, huge pages would defeat that */
+    madvise(c->pages, pages_size, MADV_NOHUGEPAGE);
+#endif
+    /* touched, so pages are backed by distinct frames, not the zero page */
+    for (size_t i = 0; i < pages_size; i += B63_PAGE_SIZE) {
+      c->pages[i] = (char)(i / B63_PAGE_SIZE);
+    }
+  }
+  return c;
+}
+
+static void b63_cache_destroy(b63_cache *c) {
+  if (c == NULL) {
+    return;
+  }
+  free(c->thrash);
+  if (c->pages != NULL) {
+    munmap(c->pages, B63_TLB_PAGES * B63_PAGE_SIZE);
+  }
+  free(c);
+}
+
+static int64_t b63_cache_read(const char *data, size_t size, size_t step) {
+  int64_t res = 0;
+  for (size_t i = 0; i < size; i += step) {
+    res += *(volatile const char *)(data + i);
+  }
+  return res;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define B63_CACHE_CLFLUSH_SUPPORTED 1
+#endif
+
+static void b63_cache_flush(const char *data, size_t size) {
+#ifdef B63_CACHE_CLFLUSH_SUPPORTED
+  for (size_t i = 0; i < size; i += B63_CACHE_LINE) {
+    __asm__ __volatile__("clflush %0" ::"m"(data[i]));
+  }
+  __asm__ __volatile__("mfence" ::: "memory");
+#endif
+}
+
+/* brings caches and TLB to the configured state */
+static void b63_cache_evict(b63_cache *c, int8_t mode) {
+  int64_t res = 0;
+  int8_t flushed = 0;
+  for (size_t i = 0; i < b63_cache_regions_size; i++) {
+    if (mode == B63_CACHE_COLD) {
+      b63_cache_flush(b63_cache_regions[i].data, b63_cache_regions[i].size);
+#ifdef B63_CACHE_CLFLUSH_SUPPORTED
+      flushed = 1;
+#endif
+    } else if (mode == B63_CACHE_LLC_ONLY) {
+      res += b63_cache_read(b63_cache_regions[i].data,
+                            b63_cache_regions[i].size, B63_CACHE_LINE);
+    }
+  }
+  if (c->thrash != NULL && !flushed) {
+    res += b63_cache_read(c->thrash, c->thrash_size, B63_CACHE_LINE);
+  }
+  if (c->pages != NULL) {
+    res += b63_cache_read(c->pages, B63_TLB_PAGES * B63_PAGE_SIZE,
+                          B63_PAGE_SIZE);
+  }
+  __asm__ __volatile__("" ::"m"(res));
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_CALIBRATION_H_
+#define _B63_CALIBRATION_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "counter.h"
+#include "suspend.h"
+
+/*
+ * Every measured batch includes the cost of two counter reads and an
+ * indirect call to the benchmark; every B63_SUSPEND adds two more reads.
+ * For benchmarks with tiny bodies that overhead is a noticeable part of
+ * the result, so before running benchmarks for a counter we measure
+ * an empty benchmark and an empty B63_SUSPEND, and subtract the medians
+ * from the results. Median absolute deviation is reported as the residual
+ * uncertainty of that correction.
+ *
+ * For coarse counters (os:utime ticks in microseconds, for example) the
+ * medians are often one tick, which is rounding rather than overhead, so
+ * corrections not above the step between back-to-back reads, or about as
+ * large as their deviation, are not applied.
+ */
+
+#define B63_CALIBRATION_SAMPLES 1001
+
+static void b63_calibration_empty(b63_epoch *b63run, uint64_t n,
+                                  int64_t b63_seed) {}
+
+static void b63_calibration_suspend(b63_epoch *b63run, uint64_t n,
+                                    int64_t b63_seed) {
+  B63_SUSPEND {}
+}
+
+static int b63_calibration_cmp(const void *a, const void *b) {
+  int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+  return (x > y) - (x < y);
+}
+
+/* sorts samples in place and computes median and median absolute deviation */
+static void b63_calibration_median(int64_t *samples, size_t size,
+                                   int64_t *median, int64_t *mad) {
+  qsort(samples, size, sizeof(int64_t), b63_calibration_cmp);
+  *median = samples[size / 2];
+  for (size_t i = 0; i < size; i++) {
+    int64_t d = samples[i] - *median;
+    samples[i] = d < 0 ? -d : d;
+  }
+  qsort(samples, size, sizeof(int64_t), b63_calibration_cmp);
+  *mad = samples[size / 2];
+}
+
+/*
+ * Correction which is distinguishable from counter rounding, or 0. If
+ * back-to-back reads never changed the counter (step 0), two reads per batch
+ * cost well below one tick, and a non-zero median is rounding too.
+ */
+static int64_t b63_calibration_significant(int64_t median, int64_t mad,
+                                           int64_t step) {
+  return step > 0 && median > step && 2 * mad < median ? median : 0;
+}
+
+/*
+ * Measures 'events' of fn the same way b63_epoch_run does for a batch,
+ * except there's no overhead subtraction yet.
+ */
+static void b63_calibration_sample(b63_epoch *e, b63_target_fn fn,
+                                   int64_t *samples) {
+  b63_counter *c = e->counter;
+  for (size_t i = 0; i < B63_CALIBRATION_SAMPLES; i++) {
+    e->events = 0;
+    int64_t started = c->type->read(c->impl);
+    fn(e, 1, 0);
+    int64_t done = c->type->read(c->impl);
+    samples[i] = e->events + (done - started);
+  }
+}
+
+static void b63_calibrate(b63_counter *c) {
+  int64_t *samples =
+      (int64_t *)malloc(B63_CALIBRATION_SAMPLES * sizeof(int64_t));
+  if (samples == NULL) {
+    fprintf(stderr, "memory allocation failed for calibration\n");
+    return;
+  }
+  b63_calibration *cal = &c->calibration;
+  memset(cal, 0, sizeof(b63_calibration));
+
+  b63_epoch e;
+  memset(&e, 0, sizeof(b63_epoch));
+  e.counter = c;
+
+  /* smallest non-zero step between back-to-back reads */
+  int64_t prev = c->type->read(c->impl);
+  for (size_t i = 0; i < B63_CALIBRATION_SAMPLES; i++) {
+    int64_t curr = c->type->read(c->impl);
+    if (curr != prev && (cal->step == 0 || curr - prev < cal->step)) {
+      cal->step = curr - prev;
+    }
+    prev = curr;
+  }
+
+  /* warm up, results are discarded */
+  b63_calibration_sample(&e, b63_calibration_empty, samples);
+
+  b63_calibration_sample(&e, b63_calibration_empty, samples);
+  b63_calibration_median(samples, B63_CALIBRATION_SAMPLES, &cal->batch,
+                         &cal->batch_mad);
+
+  b63_calibration_sample(&e, b63_calibration_suspend, samples);
+  b63_calibration_median(samples, B63_CALIBRATION_SAMPLES, &cal->suspension,
+                         &cal->suspension_mad);
+  /* suspension samples include the batch overhead as well */
+  cal->suspension -= cal->batch;
+  cal->suspension =
+      b63_calibration_significant(cal->suspension, cal->suspension_mad,
+                                  cal->step);
+  cal->batch =
+      b63_calibration_significant(cal->batch, cal->batch_mad, cal->step);
+
+  free(samples);
+}
+
+#endif
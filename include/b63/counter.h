@@ -72,6 +72,22 @@ typedef struct b63_ctype {
   const char *prefix;
 } b63_ctype;
 
+/*
+ * Measurement overhead of a counter instance, estimated at startup.
+ * See calibration.h for details.
+ */
+typedef struct b63_calibration {
+  /* median overhead per measured batch and per suspension */
+  int64_t batch, suspension;
+  /* median absolute deviation of the above, residual uncertainty */
+  int64_t batch_mad, suspension_mad;
+  /*
+   * smallest non-zero difference between back-to-back reads: the cost of
+   * a read for fine-grained counters, the tick for coarse ones
+   */
+  int64_t step;
+} b63_calibration;
+
 /*
  * This is an 'instance' of a counter, with specific configuration.
  * For example, 'lpe:cycles' and 'lpe:branch-misses' would be two
@@ -81,8 +97,15 @@ typedef struct b63_counter {
   b63_ctype *type;
   char *name;
   void *impl;
+  b63_calibration calibration;
 } b63_counter;
 
+/*
+ * If set, counters which support it (lpe) count events of child processes
+ * as well. Set by suite before counters are created, see --exec.
+ */
+static int8_t b63_counter_inherit = 0;
+
 /* Pointers to registered counter types will be stored here */
 B63_LIST_DECLARE(b63_ctype);
 
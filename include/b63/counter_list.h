@@ -58,6 +58,7 @@ static void b63_counter_list_init(b63_counter_list *counters,
   for (size_t i = 0; i < counters->size; i++) {
     counters->data[i].impl = NULL;
     counters->data[i].name = NULL;
+    memset(&counters->data[i].calibration, 0, sizeof(b63_calibration));
   }
 
   const char *b = conf, *e;
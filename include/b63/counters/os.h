@@ -0,0 +1,109 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_COUNTERS_OS_H_
+#define _B63_COUNTERS_OS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+
+#include "../counter.h"
+
+/*
+ * Resource usage counters from getrusage, for the process itself and its
+ * terminated children, so they work for external commands as well (--exec):
+ *   os:utime, os:stime  - user / system cpu time in nanoseconds
+ *                         (microsecond resolution);
+ *   os:minflt, os:majflt - minor / major page faults;
+ *   os:nvcsw, os:nivcsw  - voluntary / involuntary context switches;
+ *   os:inblock, os:oublock - block input / output operations.
+ */
+
+enum {
+  B63_OS_UTIME,
+  B63_OS_STIME,
+  B63_OS_MINFLT,
+  B63_OS_MAJFLT,
+  B63_OS_NVCSW,
+  B63_OS_NIVCSW,
+  B63_OS_INBLOCK,
+  B63_OS_OUBLOCK,
+  B63_OS_FIELDS
+};
+
+static const char *b63_counter_os_names[B63_OS_FIELDS] = {
+    "utime", "stime",  "minflt",  "majflt",
+    "nvcsw", "nivcsw", "inblock", "oublock"};
+
+typedef struct b63_counter_os {
+  int field;
+} b63_counter_os;
+
+static int8_t b63_counter_os_create(const char *conf, void **impl) {
+  const char *field = conf + strlen("os:");
+  for (int i = 0; i < B63_OS_FIELDS; i++) {
+    if (strncmp(conf, "os:", 3) == 0 &&
+        strcmp(field, b63_counter_os_names[i]) == 0) {
+      b63_counter_os *os = (b63_counter_os *)malloc(sizeof(b63_counter_os));
+      if (os == NULL) {
+        fprintf(stderr, "memory allocation failed for os counter\n");
+        return 0;
+      }
+      os->field = i;
+      *impl = os;
+      return 1;
+    }
+  }
+  fprintf(stderr, "os: unsupported field %s\n", conf);
+  return 0;
+}
+
+static int64_t b63_counter_os_field(struct rusage *ru, int field) {
+  switch (field) {
+  case B63_OS_UTIME:
+    return 1000000000LL * ru->ru_utime.tv_sec + 1000LL * ru->ru_utime.tv_usec;
+  case B63_OS_STIME:
+    return 1000000000LL * ru->ru_stime.tv_sec + 1000LL * ru->ru_stime.tv_usec;
+  case B63_OS_MINFLT:
+    return ru->ru_minflt;
+  case B63_OS_MAJFLT:
+    return ru->ru_majflt;
+  case B63_OS_NVCSW:
+    return ru->ru_nvcsw;
+  case B63_OS_NIVCSW:
+    return ru->ru_nivcsw;
+  case B63_OS_INBLOCK:
+    return ru->ru_inblock;
+  case B63_OS_OUBLOCK:
+    return ru->ru_oublock;
+  }
+  return 0;
+}
+
+B63_COUNTER(os, b63_counter_os_create) {
+  b63_counter_os *os = (b63_counter_os *)impl;
+  struct rusage self, children;
+  getrusage(RUSAGE_SELF, &self);
+  getrusage(RUSAGE_CHILDREN, &children);
+  return b63_counter_os_field(&self, os->field) +
+         b63_counter_os_field(&children, os->field);
+}
+
+#endif
@@ -46,7 +46,8 @@ typedef struct b63_counter_lpe {
  * open file descriptor to read counter. See
  * http://man7.org/linux/man-pages/man2/perf_event_open.2.html for the list
  */
-static int32_t b63_counter_lpe_open(uint32_t type, uint64_t config) {
+static int32_t b63_counter_lpe_open(uint32_t type, uint64_t config,
+                                    int8_t user, int8_t kernel) {
   struct perf_event_attr pe;
 
   memset(&pe, 0, sizeof(struct perf_event_attr));
@@ -54,8 +55,11 @@ static int32_t b63_counter_lpe_open(uint32_t type, uint64_t config) {
   pe.size = sizeof(struct perf_event_attr);
   pe.config = config;
   pe.disabled = 1;
-  pe.exclude_kernel = 1;
+  pe.exclude_user = !user;
+  pe.exclude_kernel = !kernel;
   pe.exclude_hv = 1;
+  /* child processes, for external commands */
+  pe.inherit = b63_counter_inherit;
 
   /* Counting for current process, any cpu: pid == 0, cpu == -1 */
   int32_t fd = syscall(__NR_perf_event_open, &pe, 0, -1, -1, 0);
@@ -72,23 +76,36 @@ static int32_t b63_counter_lpe_open(uint32_t type, uint64_t config) {
 /*
  * looking up type/config combination by event_name.
  * names match those of perf tool (`perf list`), for consistency.
+ * Optional modifiers after ':' also follow perf tool: 'u' counts user
+ * space, 'k' kernel, for example instructions:u or cycles:uk. Without
+ * modifiers only user space is counted.
  * returns -1 on failure.
  */
-static int32_t b63_counter_lpe_init(const char *event_name) {
+static int32_t b63_counter_lpe_init(const char *event) {
+  char event_name[128];
+  int8_t user = 1, kernel = 0;
+  snprintf(event_name, sizeof(event_name), "%s", event);
+  char *modifiers = strchr(event_name, ':');
+  if (modifiers != NULL) {
+    *modifiers++ = '\0';
+    user = strchr(modifiers, 'u') != NULL;
+    kernel = strchr(modifiers, 'k') != NULL;
+  }
   /* first, check list of predefined events */
   for (size_t i = 0; i < sizeof(b63_counter_events_flat_map) /
                              sizeof(struct b63_counter_event_map);
        ++i) {
     if (strcmp(b63_counter_events_flat_map[i].event_name, event_name) == 0) {
       return b63_counter_lpe_open(b63_counter_events_flat_map[i].type,
-                                  b63_counter_events_flat_map[i].config);
+                                  b63_counter_events_flat_map[i].config, user,
+                                  kernel);
     }
   }
   /* now, trying raw event in format r<mask><event>, for example r01a1 */
   if (strlen(event_name) > 1) {
     if (event_name[0] == 'r') {
       uint64_t conf = strtoull(event_name + 1, NULL, 16);
-      return b63_counter_lpe_open(PERF_TYPE_RAW, conf);
+      return b63_counter_lpe_open(PERF_TYPE_RAW, conf, user, kernel);
     }
   }
   fprintf(stderr, "linux perf_events: unable to find event %s\n", event_name);
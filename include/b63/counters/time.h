@@ -22,9 +22,62 @@
 #include <time.h>
 #endif
 #include "../counter.h"
+#include "../utils/timer.h"
 
-/* default counter returning time in nanoseconds */
-B63_COUNTER(time) {
+/*
+ * Default counter returning time in nanoseconds.
+ * Clock source is picked by config:
+ *   time                    - CLOCK_MONOTONIC;
+ *   time:monotonic          - same as above;
+ *   time:monotonic_raw      - CLOCK_MONOTONIC_RAW, not subject to NTP slewing;
+ *   time:tsc                - x86 time stamp counter, scaled to nanoseconds.
+ * Resolution and read cost of the chosen clock are reported by calibration,
+ * see calibration.h.
+ */
+
+typedef struct b63_counter_time {
+#ifndef NO_GET_TIME_SUPPORTED
+  clockid_t clock;
+#endif
+  int8_t tsc;
+  uint64_t tsc_base;
+  double ns_per_tick;
+} b63_counter_time;
+
+static int8_t b63_counter_time_create(const char *conf, void **impl) {
+  b63_counter_time *t = (b63_counter_time *)malloc(sizeof(b63_counter_time));
+  if (t == NULL) {
+    fprintf(stderr, "memory allocation failed for time counter\n");
+    return 0;
+  }
+  memset(t, 0, sizeof(b63_counter_time));
+  const char *clock_name = strchr(conf, ':');
+  clock_name = (clock_name == NULL) ? "monotonic" : clock_name + 1;
+#ifndef NO_GET_TIME_SUPPORTED
+  t->clock = CLOCK_MONOTONIC;
+#endif
+  if (strcmp(clock_name, "monotonic") == 0) {
+    /* default */
+#if defined(CLOCK_MONOTONIC_RAW) && !defined(NO_GET_TIME_SUPPORTED)
+  } else if (strcmp(clock_name, "monotonic_raw") == 0) {
+    t->clock = CLOCK_MONOTONIC_RAW;
+#endif
+#ifdef B63_TSC_SUPPORTED
+  } else if (strcmp(clock_name, "tsc") == 0) {
+    t->tsc = 1;
+    t->ns_per_tick = b63_tsc_ns_per_tick();
+    t->tsc_base = b63_tsc_read();
+#endif
+  } else {
+    fprintf(stderr, "time: unsupported clock %s\n", clock_name);
+    free(t);
+    return 0;
+  }
+  *impl = t;
+  return 1;
+}
+
+B63_COUNTER(time, b63_counter_time_create) {
 #ifdef NO_GET_TIME_SUPPORTED
   struct timeval tv;
 
@@ -33,9 +86,15 @@ B63_COUNTER(time) {
   else
     return 0;
 #else
-  struct timespec t;
-  clock_gettime(CLOCK_MONOTONIC, &t);
-  int64_t res = 1000000000LL * (int64_t)t.tv_sec + t.tv_nsec;
+  b63_counter_time *t = (b63_counter_time *)impl;
+#ifdef B63_TSC_SUPPORTED
+  if (t->tsc) {
+    return (int64_t)((b63_tsc_read() - t->tsc_base) * t->ns_per_tick);
+  }
+#endif
+  struct timespec ts;
+  clock_gettime(t->clock, &ts);
+  int64_t res = 1000000000LL * (int64_t)ts.tv_sec + ts.tv_nsec;
   return res;
 #endif
 }
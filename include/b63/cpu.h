@@ -0,0 +1,255 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_CPU_H_
+#define _B63_CPU_H_
+
+/*
+ * Helpers to pick CPUs to run benchmarks on and pin to them.
+ * Pinning is only implemented for Linux; elsewhere it is a no-op.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#ifdef __linux__
+#define B63_CPU_LIMIT CPU_SETSIZE
+#else
+#define B63_CPU_LIMIT 1024
+#endif
+
+/*
+ * Parses cpu list in the format used by kernel and taskset, for example
+ * '2,4,6-8'. Returns number of cpus parsed, *cpus needs to be freed.
+ * Returns 0 if the list is malformed or has cpus outside [0, B63_CPU_LIMIT).
+ */
+static size_t b63_cpu_list_parse(const char *conf, int **cpus) {
+  size_t size = 0, capacity = 16;
+  *cpus = (int *)malloc(capacity * sizeof(int));
+  if (*cpus == NULL) {
+    fprintf(stderr, "memory allocation failed for cpu list\n");
+    exit(EXIT_FAILURE);
+  }
+  const char *p = conf;
+  int8_t valid = 1;
+  while (*p != '\0' && *p != '\n') {
+    char *e;
+    long from = strtol(p, &e, 10), to;
+    if (e == p) {
+      valid = 0;
+      break;
+    }
+    to = from;
+    if (*e == '-') {
+      p = e + 1;
+      to = strtol(p, &e, 10);
+    }
+    if (e == p || from < 0 || to < from || to >= B63_CPU_LIMIT) {
+      valid = 0;
+      break;
+    }
+    for (long cpu = from; cpu <= to; cpu++) {
+      if (size == capacity) {
+        capacity *= 2;
+        *cpus = (int *)realloc(*cpus, capacity * sizeof(int));
+        if (*cpus == NULL) {
+          fprintf(stderr, "memory allocation failed for cpu list\n");
+          exit(EXIT_FAILURE);
+        }
+      }
+      (*cpus)[size++] = (int)cpu;
+    }
+    p = (*e == ',') ? e + 1 : e;
+  }
+  if (!valid) {
+    free(*cpus);
+    *cpus = NULL;
+    return 0;
+  }
+  return size;
+}
+
+/* reads cpu list from sysfs file, returns 0 if not available or empty */
+static size_t b63_cpu_list_read(const char *path, int **cpus) {
+  char buf[4096];
+  FILE *f = fopen(path, "r");
+  *cpus = NULL;
+  if (f == NULL) {
+    return 0;
+  }
+  size_t len = fread(buf, 1, sizeof(buf) - 1, f);
+  fclose(f);
+  buf[len] = '\0';
+  return b63_cpu_list_parse(buf, cpus);
+}
+
+/*
+ * CPUs benchmarks may run on: isolated cpus if there are any (isolcpus=),
+ * otherwise current affinity mask.
+ */
+static size_t b63_cpu_available(int **cpus) {
+  size_t size =
+      b63_cpu_list_read("/sys/devices/system/cpu/isolated", cpus);
+  if (size > 0) {
+    return size;
+  }
+  free(*cpus);
+#ifdef __linux__
+  cpu_set_t set;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    *cpus = (int *)malloc(CPU_SETSIZE * sizeof(int));
+    if (*cpus == NULL) {
+      fprintf(stderr, "memory allocation failed for cpu list\n");
+      exit(EXIT_FAILURE);
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) {
+        (*cpus)[size++] = cpu;
+      }
+    }
+    return size;
+  }
+#endif
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  size = n > 0 ? (size_t)n : 1;
+  *cpus = (int *)malloc(size * sizeof(int));
+  if (*cpus == NULL) {
+    fprintf(stderr, "memory allocation failed for cpu list\n");
+    exit(EXIT_FAILURE);
+  }
+  for (size_t i = 0; i < size; i++) {
+    (*cpus)[i] = (int)i;
+  }
+  return size;
+}
+
+/*
+ * Returns the lowest-numbered SMT sibling of the cpu, which identifies
+ * its physical core. Returns cpu itself if topology is unknown.
+ */
+static int b63_cpu_core(int cpu) {
+  char path[128];
+  int *siblings, res = cpu;
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  size_t size = b63_cpu_list_read(path, &siblings);
+  for (size_t i = 0; i < size; i++) {
+    if (siblings[i] < res) {
+      res = siblings[i];
+    }
+  }
+  free(siblings);
+  return res;
+}
+
+/* socket of the cpu, 0 if topology is unknown */
+static int b63_cpu_package(int cpu) {
+  char path[128];
+  int res = 0;
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+  FILE *f = fopen(path, "r");
+  if (f != NULL) {
+    if (fscanf(f, "%d", &res) != 1) {
+      res = 0;
+    }
+    fclose(f);
+  }
+  return res;
+}
+
+/*
+ * Returns the lowest-numbered cpu sharing last level (L3) cache with the
+ * cpu, which identifies the L3 group, or -1 if not known.
+ */
+static int b63_cpu_l3(int cpu) {
+  char path[128];
+  int res = -1;
+  for (int index = 0; index < 16 && res < 0; index++) {
+    int level = 0;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+      break;
+    }
+    if (fscanf(f, "%d", &level) != 1) {
+      level = 0;
+    }
+    fclose(f);
+    if (level != 3) {
+      continue;
+    }
+    int *shared;
+    snprintf(path, sizeof(path),
+             "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+             cpu, index);
+    size_t size = b63_cpu_list_read(path, &shared);
+    for (size_t i = 0; i < size; i++) {
+      if (res < 0 || shared[i] < res) {
+        res = shared[i];
+      }
+    }
+    free(shared);
+  }
+  return res;
+}
+
+/*
+ * Keeps one cpu per physical core, so that SMT siblings stay idle.
+ * Works in place, returns new size.
+ */
+static size_t b63_cpu_physical(int *cpus, size_t size) {
+  size_t res = 0;
+  for (size_t i = 0; i < size; i++) {
+    int core = b63_cpu_core(cpus[i]), seen = 0;
+    for (size_t j = 0; j < res; j++) {
+      if (b63_cpu_core(cpus[j]) == core) {
+        seen = 1;
+        break;
+      }
+    }
+    if (!seen) {
+      cpus[res++] = cpus[i];
+    }
+  }
+  return res;
+}
+
+/* pins calling thread to the cpu, returns 0 on failure */
+static int8_t b63_cpu_pin(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    fprintf(stderr, "unable to pin to cpu %d\n", cpu);
+    return 0;
+  }
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,474 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_DATA_H_
+#define _B63_DATA_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Seeded data generation for benchmark inputs:
+ *  - xoshiro256** generator, b63_rng, seeded from b63_seed;
+ *  - bulk fills for common distributions, b63_data_uniform, ..._zipf, etc;
+ *  - process-wide cache of generated datasets, b63_data_cached, so that
+ *    the same input is generated once rather than once per epoch and
+ *    counter.
+ *
+ * b63_data_random and b63_data_uniform run 4 independent generators side
+ * by side, which compilers vectorize and which is several times faster
+ * than rand() or a single generator. Other fills are scalar.
+ */
+
+/* splitmix64 step, used to expand seeds */
+static uint64_t b63_splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static inline uint64_t b63_rotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+typedef struct b63_rng {
+  uint64_t s[4];
+} b63_rng;
+
+static void b63_rng_seed(b63_rng *rng, int64_t seed) {
+  uint64_t x = (uint64_t)seed;
+  for (int i = 0; i < 4; i++) {
+    x = b63_splitmix64(x);
+    rng->s[i] = x;
+  }
+}
+
+/* xoshiro256** */
+static inline uint64_t b63_rng_next(b63_rng *rng) {
+  uint64_t *s = rng->s;
+  const uint64_t res = b63_rotl(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = b63_rotl(s[3], 45);
+  return res;
+}
+
+/* uniform in [0, 1) */
+static inline double b63_rng_double(b63_rng *rng) {
+  return (double)(b63_rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+/* uniform in [0, range), range = 0 means full 64 bit range */
+static inline uint64_t b63_rng_bounded(uint64_t x, uint64_t range) {
+  if (range == 0) {
+    return x;
+  }
+#ifdef __SIZEOF_INT128__
+  return (uint64_t)(((unsigned __int128)x * range) >> 64);
+#else
+  return x % range;
+#endif
+}
+
+/*
+ * 4 generators in structure-of-arrays layout, so that one step for all of
+ * them is a loop the compiler can vectorize.
+ */
+#define B63_RNG_LANES 4
+
+typedef struct b63_rng_lanes {
+  uint64_t s0[B63_RNG_LANES], s1[B63_RNG_LANES], s2[B63_RNG_LANES],
+      s3[B63_RNG_LANES];
+} b63_rng_lanes;
+
+static void b63_rng_lanes_seed(b63_rng_lanes *r, int64_t seed) {
+  uint64_t x = (uint64_t)seed;
+  for (int i = 0; i < B63_RNG_LANES; i++) {
+    r->s0[i] = x = b63_splitmix64(x);
+    r->s1[i] = x = b63_splitmix64(x);
+    r->s2[i] = x = b63_splitmix64(x);
+    r->s3[i] = x = b63_splitmix64(x);
+  }
+}
+
+static inline void b63_rng_lanes_next(b63_rng_lanes *r,
+                                      uint64_t out[B63_RNG_LANES]) {
+  for (int i = 0; i < B63_RNG_LANES; i++) {
+    out[i] = b63_rotl(r->s1[i] * 5, 7) * 9;
+    const uint64_t t = r->s1[i] << 17;
+    r->s2[i] ^= r->s0[i];
+    r->s3[i] ^= r->s1[i];
+    r->s1[i] ^= r->s2[i];
+    r->s0[i] ^= r->s3[i];
+    r->s2[i] ^= t;
+    r->s3[i] = b63_rotl(r->s3[i], 45);
+  }
+}
+
+/* n random 64 bit values */
+static void b63_data_random(uint64_t *out, size_t n, int64_t seed) {
+  b63_rng_lanes r;
+  b63_rng_lanes_seed(&r, seed);
+  size_t i = 0;
+  for (; i + B63_RNG_LANES <= n; i += B63_RNG_LANES) {
+    b63_rng_lanes_next(&r, out + i);
+  }
+  if (i < n) {
+    uint64_t tail[B63_RNG_LANES];
+    b63_rng_lanes_next(&r, tail);
+    memcpy(out + i, tail, (n - i) * sizeof(uint64_t));
+  }
+}
+
+/* uniform in [0, range) */
+static void b63_data_uniform(uint64_t *out, size_t n, int64_t seed,
+                             uint64_t range) {
+  b63_data_random(out, n, seed);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = b63_rng_bounded(out[i], range);
+  }
+}
+
+/* M_PI is not part of C99 */
+#define B63_DATA_2PI 6.283185307179586
+
+/* normal with given mean and stddev, Box-Muller */
+static void b63_data_normal(double *out, size_t n, int64_t seed, double mean,
+                            double stddev) {
+  b63_rng rng;
+  b63_rng_seed(&rng, seed);
+  for (size_t i = 0; i < n; i += 2) {
+    /* 1 - u is in (0, 1], so log is finite */
+    double u = 1.0 - b63_rng_double(&rng), v = b63_rng_double(&rng);
+    double r = sqrt(-2.0 * log(u));
+    out[i] = mean + stddev * r * cos(B63_DATA_2PI * v);
+    if (i + 1 < n) {
+      out[i + 1] = mean + stddev * r * sin(B63_DATA_2PI * v);
+    }
+  }
+}
+
+/*
+ * Zipf over [0, range), value k has probability ~ 1 / (k + 1)^exponent.
+ * Rejection-inversion sampling (Hormann, Derflinger), O(1) per value
+ * without precomputed tables, any exponent > 0.
+ */
+static double b63_zipf_helper1(double x) {
+  return fabs(x) > 1e-8 ? log1p(x) / x
+                        : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+static double b63_zipf_helper2(double x) {
+  return fabs(x) > 1e-8 ? expm1(x) / x
+                        : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+}
+
+static double b63_zipf_h(double x, double e) { return exp(-e * log(x)); }
+
+static double b63_zipf_hint(double x, double e) {
+  double lx = log(x);
+  return b63_zipf_helper2((1.0 - e) * lx) * lx;
+}
+
+static double b63_zipf_hint_inv(double x, double e) {
+  double t = x * (1.0 - e);
+  if (t < -1.0) {
+    t = -1.0;
+  }
+  return exp(b63_zipf_helper1(t) * x);
+}
+
+static void b63_data_zipf(uint64_t *out, size_t n, int64_t seed,
+                          uint64_t range, double exponent) {
+  b63_rng rng;
+  b63_rng_seed(&rng, seed);
+  const double e = exponent, nn = (double)range;
+  const double hx1 = b63_zipf_hint(1.5, e) - 1.0;
+  const double hn = b63_zipf_hint(nn + 0.5, e);
+  const double s = 2.0 - b63_zipf_hint_inv(b63_zipf_hint(2.5, e) -
+                                               b63_zipf_h(2.0, e),
+                                           e);
+  for (size_t i = 0; i < n; i++) {
+    for (;;) {
+      double u = hn + b63_rng_double(&rng) * (hx1 - hn);
+      double x = b63_zipf_hint_inv(u, e);
+      double k = floor(x + 0.5);
+      k = k < 1.0 ? 1.0 : (k > nn ? nn : k);
+      if (k - x <= s || u >= b63_zipf_hint(k + 0.5, e) - b63_zipf_h(k, e)) {
+        out[i] = (uint64_t)k - 1;
+        break;
+      }
+    }
+  }
+}
+
+/*
+ * Sorted uniform values in [0, range), in O(n): cumulative sum of
+ * exponential spacings has the same distribution as sorted uniform sample.
+ */
+static void b63_data_sorted(uint64_t *out, size_t n, int64_t seed,
+                            uint64_t range) {
+  b63_rng rng;
+  b63_rng_seed(&rng, seed);
+  double *gaps = (double *)malloc((n + 1) * sizeof(double));
+  if (gaps == NULL) {
+    fprintf(stderr, "memory allocation failed for data\n");
+    exit(EXIT_FAILURE);
+  }
+  double total = 0.0;
+  for (size_t i = 0; i <= n; i++) {
+    gaps[i] = -log(1.0 - b63_rng_double(&rng));
+    total += gaps[i];
+  }
+  double scale = (range == 0 ? 0x1.0p64 : (double)range) / total, sum = 0.0;
+  for (size_t i = 0; i < n; i++) {
+    sum += gaps[i];
+    double v = sum * scale;
+    out[i] = v >= 0x1.0p64 ? UINT64_MAX : (uint64_t)v;
+    if (range != 0 && out[i] >= range) {
+      out[i] = range - 1;
+    }
+  }
+  free(gaps);
+}
+
+/* sorted, then fraction 'swapped' of elements is swapped with random ones */
+static void b63_data_nearly_sorted(uint64_t *out, size_t n, int64_t seed,
+                                   uint64_t range, double swapped) {
+  b63_data_sorted(out, n, seed, range);
+  if (n < 2) {
+    return;
+  }
+  b63_rng rng;
+  b63_rng_seed(&rng, b63_splitmix64((uint64_t)seed));
+  size_t swaps = (size_t)(swapped * n / 2);
+  for (size_t i = 0; i < swaps; i++) {
+    size_t a = b63_rng_bounded(b63_rng_next(&rng), n);
+    size_t b = b63_rng_bounded(b63_rng_next(&rng), n);
+    uint64_t t = out[a];
+    out[a] = out[b];
+    out[b] = t;
+  }
+}
+
+/* values picked uniformly from 'unique' random values in [0, range) */
+static void b63_data_few_unique(uint64_t *out, size_t n, int64_t seed,
+                                uint64_t range, uint64_t unique) {
+  if (unique == 0) {
+    fprintf(stderr, "number of unique values should be positive\n");
+    exit(EXIT_FAILURE);
+  }
+  uint64_t *values = (uint64_t *)malloc(unique * sizeof(uint64_t));
+  if (values == NULL) {
+    fprintf(stderr, "memory allocation failed for data\n");
+    exit(EXIT_FAILURE);
+  }
+  b63_data_uniform(values, unique, b63_splitmix64((uint64_t)seed), range);
+  b63_data_uniform(out, n, seed, unique);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = values[out[i]];
+  }
+  free(values);
+}
+
+/*
+ * Distinct random 64 bit keys: splitmix64 is a bijection, so applying it
+ * to distinct counters gives distinct values.
+ */
+static void b63_data_keys(uint64_t *out, size_t n, int64_t seed) {
+  uint64_t base = b63_splitmix64((uint64_t)seed);
+  for (size_t i = 0; i < n; i++) {
+    out[i] = b63_splitmix64(base + i * 0x9e3779b97f4a7c15ULL);
+  }
+}
+
+/*
+ * n random strings of [a-z0-9], 'len' characters each, stored one after
+ * another with terminating zero, that is, string i starts at out + i *
+ * (len + 1).
+ */
+static void b63_data_strings(char *out, size_t n, int64_t seed, size_t len) {
+  static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+  b63_rng rng;
+  b63_rng_seed(&rng, seed);
+  for (size_t i = 0; i < n; i++) {
+    char *s = out + i * (len + 1);
+    uint64_t bits = 0;
+    for (size_t j = 0; j < len; j++) {
+      if (j % 10 == 0) {
+        bits = b63_rng_next(&rng);
+      }
+      s[j] = alphabet[bits % 36];
+      bits /= 36;
+    }
+    s[len] = '\0';
+  }
+}
+
+/* Dataset cache */
+
+enum {
+  B63_DATA_UNIFORM,       /* range */
+  B63_DATA_ZIPF,          /* range, a = exponent */
+  B63_DATA_NORMAL,        /* a = mean, b = stddev; values are double */
+  B63_DATA_SORTED,        /* range */
+  B63_DATA_NEARLY_SORTED, /* range, a = fraction swapped */
+  B63_DATA_FEW_UNIQUE,    /* range, a = number of unique values */
+  B63_DATA_KEYS,          /* distinct keys */
+  B63_DATA_STRINGS,       /* range = string length */
+};
+
+/* cached datasets above this size are evicted, least recently used first */
+#ifndef B63_DATA_CACHE_BYTES
+#define B63_DATA_CACHE_BYTES (256LL << 20)
+#endif
+
+typedef struct b63_data_entry {
+  int kind;
+  size_t size;
+  int64_t seed;
+  int64_t range;
+  double a, b;
+  size_t bytes;
+  void *data;
+  struct b63_data_entry *next;
+} b63_data_entry;
+
+/* most recently used first */
+static b63_data_entry *b63_data_cache = NULL;
+
+static size_t b63_data_bytes(int kind, size_t n, int64_t range) {
+  return n * (kind == B63_DATA_STRINGS ? (size_t)range + 1 : 8);
+}
+
+/* generates dataset of given kind into newly allocated buffer */
+static void *b63_data_generate(int kind, size_t n, int64_t seed,
+                               int64_t range, double a, double b) {
+  size_t bytes = b63_data_bytes(kind, n, range);
+  void *res = malloc(bytes > 0 ? bytes : 1);
+  if (res == NULL) {
+    fprintf(stderr, "memory allocation failed for data\n");
+    exit(EXIT_FAILURE);
+  }
+  uint64_t *u = (uint64_t *)res;
+  switch (kind) {
+  case B63_DATA_UNIFORM:
+    b63_data_uniform(u, n, seed, (uint64_t)range);
+    break;
+  case B63_DATA_ZIPF:
+    b63_data_zipf(u, n, seed, (uint64_t)range, a);
+    break;
+  case B63_DATA_NORMAL:
+    b63_data_normal((double *)res, n, seed, a, b);
+    break;
+  case B63_DATA_SORTED:
+    b63_data_sorted(u, n, seed, (uint64_t)range);
+    break;
+  case B63_DATA_NEARLY_SORTED:
+    b63_data_nearly_sorted(u, n, seed, (uint64_t)range, a);
+    break;
+  case B63_DATA_FEW_UNIQUE:
+    b63_data_few_unique(u, n, seed, (uint64_t)range, (uint64_t)a);
+    break;
+  case B63_DATA_KEYS:
+    b63_data_keys(u, n, seed);
+    break;
+  case B63_DATA_STRINGS:
+    b63_data_strings((char *)res, n, seed, (size_t)range);
+    break;
+  default:
+    fprintf(stderr, "unknown data kind: %d\n", kind);
+    exit(EXIT_FAILURE);
+  }
+  return res;
+}
+
+/*
+ * Dataset for (kind, n, seed, range, a, b), generated on first request.
+ * Integer parameters are passed as range, so that they are exact above
+ * 2^53. Data is shared, so benchmarks modifying it (sorting, for example)
+ * should work on a copy; memcpy is still much faster than generating it
+ * again. Seeds change every epoch, so the cache keeps at most
+ * B63_DATA_CACHE_BYTES and evicts least recently used datasets: returned
+ * pointer stays valid while datasets requested after it fit in that
+ * limit, or until b63_data_cache_clear. Not thread-safe.
+ */
+static const void *b63_data_cached(int kind, size_t n, int64_t seed,
+                                   int64_t range, double a, double b) {
+  for (b63_data_entry **p = &b63_data_cache; *p != NULL; p = &(*p)->next) {
+    b63_data_entry *e = *p;
+    if (e->kind == kind && e->size == n && e->seed == seed &&
+        e->range == range && e->a == a && e->b == b) {
+      *p = e->next;
+      e->next = b63_data_cache;
+      b63_data_cache = e;
+      return e->data;
+    }
+  }
+  b63_data_entry *e = (b63_data_entry *)malloc(sizeof(b63_data_entry));
+  if (e == NULL) {
+    fprintf(stderr, "memory allocation failed for data\n");
+    exit(EXIT_FAILURE);
+  }
+  e->kind = kind;
+  e->size = n;
+  e->seed = seed;
+  e->range = range;
+  e->a = a;
+  e->b = b;
+  e->bytes = b63_data_bytes(kind, n, range);
+  e->data = b63_data_generate(kind, n, seed, range, a, b);
+  e->next = b63_data_cache;
+  b63_data_cache = e;
+
+  /* the new dataset itself is kept even if it's over the limit alone */
+  b63_data_entry **p = &e->next;
+  size_t kept = e->bytes;
+  while (*p != NULL && kept + (*p)->bytes <= B63_DATA_CACHE_BYTES) {
+    kept += (*p)->bytes;
+    p = &(*p)->next;
+  }
+  while (*p != NULL) {
+    b63_data_entry *evicted = *p;
+    *p = evicted->next;
+    free(evicted->data);
+    free(evicted);
+  }
+  return e->data;
+}
+
+/*
+ * Releases all cached datasets. Called when the suite is done; benchmarks
+ * may call it earlier, once they no longer use pointers they got.
+ */
+static void b63_data_cache_clear() {
+  while (b63_data_cache != NULL) {
+    b63_data_entry *next = b63_data_cache->next;
+    free(b63_data_cache->data);
+    free(b63_data_cache);
+    b63_data_cache = next;
+  }
+}
+
+#endif
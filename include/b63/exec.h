@@ -0,0 +1,106 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_EXEC_H_
+#define _B63_EXEC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "benchmark.h"
+#include "suite.h"
+#include "suspend.h"
+
+/*
+ * Benchmarking external commands (--exec). Every iteration forks and runs
+ * the command with 'sh -c', and waits for it. Counters measure the whole
+ * thing from the parent process: time is wall time, lpe counters are
+ * created with 'inherit' and include events of the children, os: counters
+ * include resource usage of terminated children.
+ * Optional --setup and --cleanup commands run before and after every
+ * iteration, in B63_SUSPEND.
+ */
+
+/* runs command and waits for it; returns 0 if it exited successfully */
+static int b63_exec_command(const char *command) {
+  pid_t pid = fork();
+  if (pid == -1) {
+    fprintf(stderr, "fork failed\n");
+    return -1;
+  }
+  if (pid == 0) {
+    execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+    _exit(127);
+  }
+  int status = 0;
+  if (waitpid(pid, &status, 0) == -1) {
+    return -1;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void b63_exec_run(b63_epoch *b63run, uint64_t n, int64_t b63_seed) {
+  b63_benchmark *b = b63run->benchmark;
+  b63_suite *suite = b->suite;
+  for (uint64_t i = 0; i < n && !b63run->fail; i++) {
+    if (suite->exec_setup != NULL) {
+      B63_SUSPEND {
+        if (b63_exec_command(suite->exec_setup) != 0) {
+          fprintf(stderr, "setup command failed: %s\n", suite->exec_setup);
+          b63run->fail = 1;
+        }
+      }
+    }
+    if (b63_exec_command(b->command) != 0) {
+      fprintf(stderr, "command failed: %s\n", b->command);
+      b63run->fail = 1;
+    }
+    if (suite->exec_cleanup != NULL) {
+      B63_SUSPEND {
+        if (b63_exec_command(suite->exec_cleanup) != 0) {
+          fprintf(stderr, "cleanup command failed: %s\n", suite->exec_cleanup);
+          b63run->fail = 1;
+        }
+      }
+    }
+  }
+}
+
+/* creates benchmark for external command */
+static b63_benchmark *b63_exec_benchmark(b63_suite *suite, const char *command,
+                                         int8_t baseline) {
+  b63_benchmark *b = (b63_benchmark *)malloc(sizeof(b63_benchmark));
+  if (b == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark\n");
+    exit(EXIT_FAILURE);
+  }
+  /* run and is_baseline are const, so the struct is copied as a whole */
+  b63_benchmark proto = {
+      .name = command,
+      .run = b63_exec_run,
+      .is_baseline = baseline,
+      .suite = suite,
+      .command = command,
+  };
+  memcpy((void *)b, &proto, sizeof(b63_benchmark));
+  return b;
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_FIXTURE_H_
+#define _B63_FIXTURE_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cache.h"
+#include "utils/section_ptr_list.h"
+
+/*
+ * Fixtures are inputs shared by benchmarks, built outside of measurement
+ * once per suite, rather than in B63_SUSPEND on every batch:
+ *
+ * typedef struct { int32_t *data; size_t size; } array_t;
+ *
+ * B63_FIXTURE(arr, array_t) {       // 'arr' is array_t *, zero-initialized
+ *   arr->size = 1 << 20;
+ *   arr->data = malloc(arr->size * sizeof(int32_t));
+ *   ... fill using b63_seed ...
+ * }
+ *
+ * B63_TEARDOWN(arr) { free(arr->data); }
+ *
+ * B63_RESET(arr) { ... }            // optional, before every batch
+ *
+ * B63_BENCHMARK_F(sum, arr, n) {    // 'arr' is available here too
+ *   ...
+ * }
+ *
+ * B63_FIXTURE_SEEDED is built again for every seed, that is, every epoch.
+ * Storage is allocated with calloc, so for C++ the type should not need
+ * a constructor.
+ */
+
+typedef void (*b63_fixture_fn)(void *, int64_t);
+
+typedef struct b63_fixture {
+  const char *name;
+  size_t size;
+  b63_fixture_fn setup;
+  /* optional hooks, attached from b63_fixture_hook list */
+  b63_fixture_fn teardown;
+  b63_fixture_fn reset;
+  /* called for every input of the pool, see pool.h */
+  b63_fixture_fn input_teardown;
+  /* rebuild the fixture when seed changes */
+  int8_t per_seed;
+  /* fixture is an input pool, param is its size; see pool.h */
+  int8_t pool;
+  /* NULL until built */
+  void *data;
+  int64_t seed;
+  /* benchmark argument the fixture was built for, rebuilt when it changes */
+  int64_t param;
+} b63_fixture;
+
+/*
+ * Teardown and reset are defined after the fixture itself, so they are
+ * registered in a separate list and attached at suite start.
+ */
+enum { B63_FIXTURE_TEARDOWN, B63_FIXTURE_RESET, B63_FIXTURE_INPUT_TEARDOWN };
+
+typedef struct b63_fixture_hook {
+  b63_fixture *fixture;
+  int kind;
+  b63_fixture_fn fn;
+} b63_fixture_hook;
+
+B63_LIST_DECLARE(b63_fixture_hook)
+/* keeps the section non-empty when there are no hooks */
+B63_LIST_ADD(b63_fixture_hook, b63_fixture_hook_none, NULL)
+
+#define B63_FIXTURE_IMPL(fname, type, seeded)                                  \
+  typedef type b63_fixture_type_##fname;                                       \
+  static void b63_setup_##fname(type *, int64_t);                              \
+  static void b63_setup_any_##fname(void *f, int64_t seed) {                   \
+    b63_setup_##fname((type *)f, seed);                                        \
+  }                                                                            \
+  static b63_fixture b63_f_##fname = {                                         \
+      .name = #fname,                                                          \
+      .size = sizeof(type),                                                    \
+      .setup = b63_setup_any_##fname,                                          \
+      .per_seed = seeded,                                                      \
+  };                                                                           \
+  static void b63_setup_##fname(type *fname, int64_t b63_seed)
+
+#define B63_FIXTURE(fname, type) B63_FIXTURE_IMPL(fname, type, 0)
+#define B63_FIXTURE_SEEDED(fname, type) B63_FIXTURE_IMPL(fname, type, 1)
+
+#define B63_FIXTURE_HOOK(fname, hook, hook_kind)                               \
+  static void b63_##hook##_##fname(b63_fixture_type_##fname *, int64_t);       \
+  static void b63_##hook##_any_##fname(void *f, int64_t seed) {                \
+    b63_##hook##_##fname((b63_fixture_type_##fname *)f, seed);                 \
+  }                                                                            \
+  static b63_fixture_hook b63_fh_##hook##_##fname = {                          \
+      .fixture = &b63_f_##fname,                                               \
+      .kind = hook_kind,                                                         \
+      .fn = b63_##hook##_any_##fname,                                          \
+  };                                                                           \
+  B63_LIST_ADD(b63_fixture_hook, fixture_##hook##_##fname,                     \
+               &b63_fh_##hook##_##fname);                                      \
+  static void b63_##hook##_##fname(b63_fixture_type_##fname *fname,           \
+                                   int64_t b63_seed)
+
+/* called once when fixture is destroyed */
+#define B63_TEARDOWN(fname)                                                    \
+  B63_FIXTURE_HOOK(fname, teardown, B63_FIXTURE_TEARDOWN)
+
+/* called before every measured batch, for benchmarks mutating the fixture */
+#define B63_RESET(fname) B63_FIXTURE_HOOK(fname, reset, B63_FIXTURE_RESET)
+
+static void b63_fixture_attach_hooks() {
+  B63_LIST_FOR_EACH(b63_fixture_hook, h) {
+    if (*h == NULL) {
+      continue;
+    }
+    if ((*h)->kind == B63_FIXTURE_TEARDOWN) {
+      (*h)->fixture->teardown = (*h)->fn;
+    } else if ((*h)->kind == B63_FIXTURE_INPUT_TEARDOWN) {
+      (*h)->fixture->input_teardown = (*h)->fn;
+    } else {
+      (*h)->fixture->reset = (*h)->fn;
+    }
+  }
+}
+
+static void b63_fixture_release(b63_fixture *f) {
+  if (f->data == NULL) {
+    return;
+  }
+  /* regions registered in setup are about to be freed */
+  b63_cache_unregister_impl(NULL, f);
+  if (f->teardown != NULL) {
+    f->teardown(f->data, f->seed);
+  }
+  free(f->data);
+  f->data = NULL;
+}
+
+/*
+ * builds the fixture, unless it was built already for this seed and
+ * benchmark argument
+ */
+static void b63_fixture_acquire(b63_fixture *f, int64_t seed, int64_t param) {
+  if (f->data != NULL && (!f->per_seed || f->seed == seed) &&
+      f->param == param) {
+    return;
+  }
+  b63_fixture_release(f);
+  f->param = param;
+  f->data = calloc(1, f->size);
+  if (f->data == NULL) {
+    fprintf(stderr, "memory allocation failed for fixture %s\n", f->name);
+    exit(EXIT_FAILURE);
+  }
+  f->seed = seed;
+  b63_cache_owner = f;
+  f->setup(f->data, seed);
+  b63_cache_owner = NULL;
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_IO_H_
+#define _B63_IO_H_
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "fixture.h"
+
+/*
+ * File I/O benchmarks. B63_IO_FILE defines a fixture with a temporary file
+ * of given size, filled with seeded data, in --io-dir (TMPDIR or /tmp by
+ * default). The file is unlinked right after it's opened, so nothing is
+ * left behind. With --io-cache=cold, dirty pages are written back and the
+ * file is dropped from page cache (posix_fadvise DONTNEED) before every
+ * batch, outside of measurement; default is warm. Cold batches are single
+ * operations, as with --cache=cold, so every operation starts from a cold
+ * page cache.
+ *
+ * B63_IO_FILE(data, 1 << 30);
+ *
+ * B63_IO_BENCHMARK(random_read, data) {   // 'data' is b63_io_file *
+ *   B63_SET_BYTES(b63run, 4096);
+ *   pread(data->fd, data->buffer, 4096, ...);
+ * }
+ *
+ * B63_IO_BENCHMARK body is a single operation, like latency benchmarks, so
+ * it's reported with p50 .. max latency, items are operations (M/s is
+ * millions of IOPS) and bytes set with B63_SET_BYTES give GB/s. Files can
+ * be used with B63_BENCHMARK_F as well, for example for mmap scans.
+ *
+ * B63_IO_FILE_DIRECT also opens the file with O_DIRECT, as direct_fd;
+ * it is -1 where the filesystem doesn't support it (tmpfs, for example).
+ * Direct I/O needs aligned buffers, offsets and sizes: buffer is aligned
+ * to B63_IO_ALIGN.
+ */
+
+#define B63_IO_ALIGN 4096
+#define B63_IO_BUFFER (1 << 20)
+
+/* set from --io-dir and --io-cache */
+static const char *b63_io_dir = NULL;
+static int8_t b63_io_cold = 0;
+
+typedef struct b63_io_file {
+  /* buffered descriptor, and O_DIRECT one or -1 */
+  int fd;
+  int direct_fd;
+  int64_t size;
+  /* B63_IO_BUFFER bytes aligned to B63_IO_ALIGN, free for the body */
+  char *buffer;
+} b63_io_file;
+
+static void b63_io_file_create(b63_io_file *f, int64_t size, int64_t seed,
+                               int8_t direct) {
+  const char *dir = b63_io_dir;
+  if (dir == NULL) {
+    dir = getenv("TMPDIR") != NULL ? getenv("TMPDIR") : "/tmp";
+  }
+  char *path = (char *)malloc(strlen(dir) + 16);
+  if (path == NULL ||
+      posix_memalign((void **)&f->buffer, B63_IO_ALIGN, B63_IO_BUFFER) != 0) {
+    fprintf(stderr, "memory allocation failed for io file\n");
+    exit(EXIT_FAILURE);
+  }
+  sprintf(path, "%s/b63_io_XXXXXX", dir);
+  f->fd = mkstemp(path);
+  if (f->fd < 0) {
+    fprintf(stderr, "unable to create file in %s\n", dir);
+    exit(EXIT_FAILURE);
+  }
+  f->size = size;
+  f->direct_fd = -1;
+  if (direct) {
+#ifdef O_DIRECT
+    f->direct_fd = open(path, O_RDWR | O_DIRECT);
+#endif
+    if (f->direct_fd < 0) {
+      fprintf(stderr, "O_DIRECT is not supported in %s\n", dir);
+    }
+  }
+  unlink(path);
+  free(path);
+
+  uint64_t state = (uint64_t)seed;
+  for (int64_t written = 0; written < size;) {
+    uint64_t *words = (uint64_t *)f->buffer;
+    for (size_t i = 0; i < B63_IO_BUFFER / sizeof(uint64_t); i++) {
+      words[i] = b63_splitmix64(state + written / sizeof(uint64_t) + i);
+    }
+    int64_t chunk = size - written < B63_IO_BUFFER ? size - written
+                                                   : B63_IO_BUFFER;
+    ssize_t res = pwrite(f->fd, f->buffer, chunk, written);
+    if (res <= 0) {
+      fprintf(stderr, "unable to write io file\n");
+      exit(EXIT_FAILURE);
+    }
+    written += res;
+  }
+  if (fsync(f->fd) != 0) {
+    fprintf(stderr, "unable to sync io file\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void b63_io_file_destroy(b63_io_file *f) {
+  close(f->fd);
+  if (f->direct_fd >= 0) {
+    close(f->direct_fd);
+  }
+  free(f->buffer);
+}
+
+/* writes back dirty pages and drops the file from page cache */
+static void b63_io_evict(b63_io_file *f) {
+  if (fsync(f->fd) != 0) {
+    fprintf(stderr, "unable to sync io file\n");
+    exit(EXIT_FAILURE);
+  }
+#ifdef POSIX_FADV_DONTNEED
+  if (posix_fadvise(f->fd, 0, 0, POSIX_FADV_DONTNEED) != 0) {
+    fprintf(stderr, "unable to drop io file from page cache\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+}
+
+static void b63_io_teardown_any(void *f, int64_t seed) {
+  (void)seed;
+  b63_io_file_destroy((b63_io_file *)f);
+}
+
+static void b63_io_reset_any(void *f, int64_t seed) {
+  (void)seed;
+  if (b63_io_cold) {
+    b63_io_evict((b63_io_file *)f);
+  }
+}
+
+#define B63_IO_FILE_IMPL(fname, bytes, direct)                                 \
+  typedef b63_io_file b63_fixture_type_##fname;                                \
+  static void b63_setup_any_##fname(void *f, int64_t seed) {                   \
+    b63_io_file_create((b63_io_file *)f, (bytes), seed, direct);               \
+  }                                                                            \
+  static b63_fixture b63_f_##fname = {                                         \
+      .name = #fname,                                                          \
+      .size = sizeof(b63_io_file),                                             \
+      .setup = b63_setup_any_##fname,                                          \
+      .teardown = b63_io_teardown_any,                                         \
+      .reset = b63_io_reset_any,                                               \
+  }
+
+#define B63_IO_FILE(fname, bytes) B63_IO_FILE_IMPL(fname, bytes, 0)
+#define B63_IO_FILE_DIRECT(fname, bytes) B63_IO_FILE_IMPL(fname, bytes, 1)
+
+#endif
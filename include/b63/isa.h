@@ -0,0 +1,161 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_ISA_H_
+#define _B63_ISA_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Support for B63_BENCHMARK_ISA (see register.h): the body is compiled once
+ * per target with __attribute__((target(...))), and variants the host CPU
+ * doesn't support are not run.
+ */
+
+/* max number of targets in one B63_BENCHMARK_ISA */
+#define B63_ISA_MAX_TARGETS 8
+
+/* number of arguments, up to B63_ISA_MAX_TARGETS */
+#define B63_ISA_NARGS(...) B63_ISA_NARGS_(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1)
+#define B63_ISA_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+
+#define B63_ISA_CAT(a, b) B63_ISA_CAT_(a, b)
+#define B63_ISA_CAT_(a, b) a##b
+
+/*
+ * Expands B63_ISA_VARIANT for every target. Variants are numbered from the
+ * last one, so the first target has index 'total'; isa_index counts from
+ * the first one instead, so that variants are run in declaration order.
+ */
+#define B63_ISA_VARIANTS(name, ...)                                            \
+  B63_ISA_CAT(B63_ISA_VARIANTS_, B63_ISA_NARGS(__VA_ARGS__))                   \
+  (name, B63_ISA_NARGS(__VA_ARGS__), __VA_ARGS__)
+
+#define B63_ISA_VARIANTS_1(name, total, t) B63_ISA_VARIANT(name, 1, total, t)
+#define B63_ISA_VARIANTS_2(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 2, total, t)                                           \
+  B63_ISA_VARIANTS_1(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_3(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 3, total, t)                                           \
+  B63_ISA_VARIANTS_2(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_4(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 4, total, t)                                           \
+  B63_ISA_VARIANTS_3(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_5(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 5, total, t)                                           \
+  B63_ISA_VARIANTS_4(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_6(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 6, total, t)                                           \
+  B63_ISA_VARIANTS_5(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_7(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 7, total, t)                                           \
+  B63_ISA_VARIANTS_6(name, total, __VA_ARGS__)
+#define B63_ISA_VARIANTS_8(name, total, t, ...)                                \
+  B63_ISA_VARIANT(name, 8, total, t)                                           \
+  B63_ISA_VARIANTS_7(name, total, __VA_ARGS__)
+
+/*
+ * Wrapper compiled for the target. Body is always_inline, so it's
+ * optimized (vectorized, etc.) with the target's instruction set.
+ * Variants are compared with the first target, not with the suite baseline.
+ */
+#define B63_ISA_VARIANT(bname, index, total, isa_target)                       \
+  __attribute__((target(isa_target))) static void                              \
+      b63_run_##bname##_isa##index(b63_epoch *e, uint64_t n, int64_t seed) {   \
+    b63_isa_body_##bname(e, n, seed);                                          \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname##_isa##index = {                          \
+      .name = #bname "/" isa_target,                                           \
+      .run = b63_run_##bname##_isa##index,                                     \
+      .is_baseline = 0,                                                        \
+      .failed = 0,                                                             \
+      .isa = isa_target,                                                       \
+      .isa_default = &b63_b_##bname##_isa##total,                              \
+      .isa_index = total - index,                                              \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname##_isa##index, &b63_b_##bname##_isa##index);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define B63_ISA_FEATURE(f)                                                     \
+  if (strcmp(feature, f) == 0) {                                               \
+    return __builtin_cpu_supports(f) != 0;                                     \
+  }
+
+/* __builtin_cpu_supports needs a literal, so features are listed here */
+static int8_t b63_isa_feature_supported(const char *feature) {
+  B63_ISA_FEATURE("mmx")
+  B63_ISA_FEATURE("sse")
+  B63_ISA_FEATURE("sse2")
+  B63_ISA_FEATURE("sse3")
+  B63_ISA_FEATURE("ssse3")
+  B63_ISA_FEATURE("sse4.1")
+  B63_ISA_FEATURE("sse4.2")
+  B63_ISA_FEATURE("popcnt")
+  B63_ISA_FEATURE("avx")
+  B63_ISA_FEATURE("avx2")
+  B63_ISA_FEATURE("fma")
+  B63_ISA_FEATURE("bmi")
+  B63_ISA_FEATURE("bmi2")
+  B63_ISA_FEATURE("avx512f")
+  B63_ISA_FEATURE("avx512vl")
+  B63_ISA_FEATURE("avx512bw")
+  B63_ISA_FEATURE("avx512dq")
+  B63_ISA_FEATURE("avx512cd")
+  B63_ISA_FEATURE("avx512vbmi")
+  B63_ISA_FEATURE("avx512ifma")
+  return 0;
+}
+#undef B63_ISA_FEATURE
+#else
+static int8_t b63_isa_feature_supported(const char *feature) {
+  (void)feature;
+  return 0;
+}
+#endif
+
+/*
+ * Checks if all features in comma-separated target are supported by the
+ * host. Unknown features, for example "arch=...", are reported as not
+ * supported, so that the benchmark is skipped rather than hitting an
+ * illegal instruction.
+ */
+static int8_t b63_isa_supported(const char *target) {
+  if (strcmp(target, "default") == 0) {
+    return 1;
+  }
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+#endif
+  char feature[32];
+  const char *begin = target;
+  while (*begin != '\0') {
+    size_t len = strcspn(begin, ",");
+    if (len >= sizeof(feature)) {
+      return 0;
+    }
+    memcpy(feature, begin, len);
+    feature[len] = '\0';
+    if (!b63_isa_feature_supported(feature)) {
+      return 0;
+    }
+    begin += len + (begin[len] == ',');
+  }
+  return 1;
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_LATENCY_H_
+#define _B63_LATENCY_H_
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "benchmark.h"
+#include "calibration.h"
+#include "data.h"
+#include "utils/histogram.h"
+#include "utils/timer.h"
+
+/*
+ * Latency benchmarks: the framework drives the loop and timestamps
+ * individual operations (every one, or every --latency-sample=N-th one)
+ * into a preallocated histogram. At the end of each epoch the histogram
+ * is turned into B63_LATENCY_VALUES numbers in nanoseconds, which are
+ * reported and compared with baseline epoch by epoch, the same way
+ * as counter values.
+ *
+ * Open-loop mode (--load): instead of starting the next operation when
+ * the previous one is done, operations are started on a schedule at the
+ * offered rate, constant or Poisson, and latency is measured from the
+ * scheduled arrival, not from the actual start. When the operation can't
+ * keep up, waiting for the previous ones is counted, as it would be for
+ * requests queued in production (no coordinated omission). Schedule
+ * starts again with every batch, so any backlog is drained between
+ * batches. Open-loop instances are not compared with the baseline.
+ */
+
+static const char *b63_latency_names[B63_LATENCY_VALUES] = {
+    "p50", "p90", "p99", "p999", "max"};
+static const double b63_latency_quantiles[B63_LATENCY_VALUES] = {
+    0.5, 0.9, 0.99, 0.999, 1.0};
+
+/*
+ * cheapest clock available: TSC ticks on x86, nanoseconds elsewhere.
+ * TSC reads are fenced, so operations don't overlap with the timestamps.
+ */
+static inline int64_t b63_latency_now() {
+#ifdef B63_TSC_SUPPORTED
+  return b63_tsc_read_ordered();
+#else
+  return b63_monotonic_ns();
+#endif
+}
+
+static double b63_latency_ns_per_tick() {
+#ifdef B63_TSC_SUPPORTED
+  return b63_tsc_ns_per_tick();
+#else
+  return 1.0;
+#endif
+}
+
+/* median cost of two back-to-back clock reads, subtracted from quantiles */
+static int64_t b63_latency_calibrate() {
+  int64_t *samples =
+      (int64_t *)malloc(B63_CALIBRATION_SAMPLES * sizeof(int64_t));
+  if (samples == NULL) {
+    fprintf(stderr, "memory allocation failed for calibration\n");
+    return 0;
+  }
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t i = 0; i < B63_CALIBRATION_SAMPLES; i++) {
+      int64_t started = b63_latency_now();
+      samples[i] = b63_latency_now() - started;
+    }
+  }
+  int64_t median, mad;
+  b63_calibration_median(samples, B63_CALIBRATION_SAMPLES, &median, &mad);
+  free(samples);
+  return median;
+}
+
+/* arrival schedule is a cyclic table of gaps, power of two */
+#define B63_LOAD_ARRIVALS 4096
+
+enum { B63_ARRIVALS_POISSON = 0, B63_ARRIVALS_CONSTANT };
+
+/* fills the gaps table for rate ops/s, in clock ticks */
+static void b63_load_schedule(int64_t *gaps, int64_t rate, int8_t arrivals,
+                              int64_t seed) {
+  double ticks = 1e9 / rate / b63_latency_ns_per_tick();
+  b63_rng rng;
+  b63_rng_seed(&rng, (uint64_t)seed);
+  double t = 0.0;
+  int64_t prev = 0;
+  for (int i = 0; i < B63_LOAD_ARRIVALS; i++) {
+    if (arrivals == B63_ARRIVALS_CONSTANT) {
+      t += ticks;
+    } else {
+      t -= ticks * log(1.0 - b63_rng_double(&rng));
+    }
+    /* rounding is carried over, so the mean gap is exact */
+    gaps[i] = (int64_t)t - prev;
+    prev = (int64_t)t;
+  }
+}
+
+/*
+ * Converts the histogram of epoch e into nanoseconds.
+ * overhead is in clock ticks. Quantiles are interpolated within histogram
+ * buckets, so they are rounded down to whole ticks before the overhead is
+ * subtracted: anything within a tick of the read cost is reported as 0.
+ */
+static void b63_latency_epoch_done(b63_epoch *e, int64_t overhead) {
+  double ns_per_tick = b63_latency_ns_per_tick();
+  for (int i = 0; i < B63_LATENCY_VALUES; i++) {
+    double v = b63_histogram_quantile(e->histogram, b63_latency_quantiles[i]);
+    v = floor(v);
+    v = v > overhead ? v - overhead : 0.0;
+    e->latency[i] = v * ns_per_tick;
+  }
+}
+
+/*
+ * Open-loop body: waits for the scheduled arrival if ahead of it, and
+ * records time from the arrival to completion of every operation.
+ */
+#define B63_LOAD_LOOP(op, e, n, seed, h)                                       \
+  do {                                                                         \
+    const int64_t *b63_gaps = (e)->arrivals;                                   \
+    const int64_t b63_first = b63_latency_now();                               \
+    int64_t b63_arrival = b63_first, b63_done = b63_first;                     \
+    for (uint64_t b63_i = 0; b63_i < (n); b63_i++) {                           \
+      while (b63_latency_now() < b63_arrival) {                                \
+      }                                                                        \
+      op((e), (seed));                                                         \
+      b63_done = b63_latency_now();                                            \
+      b63_histogram_add((h), b63_done - b63_arrival);                          \
+      b63_arrival +=                                                           \
+          b63_gaps[((e)->iterations + b63_i) & (B63_LOAD_ARRIVALS - 1)];       \
+    }                                                                          \
+    (e)->load_ticks += b63_done - b63_first;                                   \
+  } while (0)
+
+/*
+ * Body of the latency benchmark loop; 'op' is the benchmark body for
+ * a single operation, inlined at both call sites.
+ */
+#define B63_LATENCY_LOOP(op, e, n, seed, sample)                               \
+  do {                                                                         \
+    b63_histogram *b63_h = (e)->histogram;                                     \
+    if ((e)->arrivals != NULL) {                                               \
+      B63_LOAD_LOOP(op, e, n, seed, b63_h);                                    \
+      break;                                                                   \
+    }                                                                          \
+    int64_t b63_countdown = (e)->latency_countdown;                            \
+    for (uint64_t b63_i = 0; b63_i < (n); b63_i++) {                           \
+      if (--b63_countdown == 0) {                                              \
+        b63_countdown = (sample);                                              \
+        int64_t b63_started = b63_latency_now();                               \
+        op((e), (seed));                                                       \
+        b63_histogram_add(b63_h, b63_latency_now() - b63_started);             \
+      } else {                                                                 \
+        op((e), (seed));                                                       \
+      }                                                                        \
+    }                                                                          \
+    (e)->latency_countdown = b63_countdown;                                    \
+  } while (0)
+
+#endif
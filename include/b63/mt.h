@@ -0,0 +1,252 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_MT_H_
+#define _B63_MT_H_
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "counter.h"
+#include "cpu.h"
+#include "data.h"
+#include "register.h"
+#include "suite.h"
+
+/*
+ * Multithreaded benchmarks: body runs on 'threads' threads at once, each
+ * doing n iterations:
+ *
+ * B63_BENCHMARK_MT(push, n, 4) {
+ *   for (uint64_t i = 0; i < n; i++) {
+ *     ... b63_thread_index is 0 .. 3, b63_seed is different per thread ...
+ *   }
+ * }
+ *
+ * For every batch, threads are started and pinned to cpus (from --cpus, or
+ * all available), create their own instance of the counter, and wait on a
+ * spin barrier, so that they all start at once. Every thread reads its own
+ * counter, B63_SUSPEND works per thread as well.
+ *
+ * Benchmark result is the slowest thread, which is when the batch is done,
+ * per iteration; it is compared to baseline as usual. In addition, min, mean
+ * and max per-thread values and their imbalance (max / min) are reported,
+ * as well as aggregate throughput: items are threads per iteration, unless
+ * set with B63_SET_ITEMS, which is then multiplied by number of threads.
+ *
+ * Requires -lpthread on older systems. Phases (phase.h) are not supported.
+ */
+
+typedef void (*b63_mt_fn)(b63_epoch *, uint64_t, int64_t, int);
+
+/* shared state of one batch */
+typedef struct b63_mt_batch {
+  b63_epoch *epoch;
+  b63_mt_fn fn;
+  uint64_t n;
+  int64_t seed;
+  int *cpus;
+  size_t cpus_size;
+  /* spin barrier: threads ready, and release flag */
+  int32_t ready;
+  int32_t go;
+} b63_mt_batch;
+
+typedef struct b63_mt_worker {
+  pthread_t thread;
+  int index;
+  b63_mt_batch *batch;
+  /* thread-local copy of the epoch, with thread's own counter */
+  b63_epoch epoch;
+  b63_counter counter;
+  int8_t counter_ok;
+  /* counter value for the batch, suspensions excluded */
+  int64_t events;
+} b63_mt_worker;
+
+static inline void b63_mt_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#endif
+}
+
+/*
+ * Spins until *v == expected. Spinning threads might be sharing a cpu with
+ * the ones they are waiting for, so after a while the cpu is yielded.
+ */
+static void b63_mt_spin_until(int32_t *v, int32_t expected) {
+  for (int64_t i = 0; __atomic_load_n(v, __ATOMIC_ACQUIRE) != expected; i++) {
+    if (i < (1 << 16)) {
+      b63_mt_pause();
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+static void *b63_mt_worker_main(void *arg) {
+  b63_mt_worker *w = (b63_mt_worker *)arg;
+  b63_mt_batch *b = w->batch;
+  b63_counter *main_counter = b->epoch->counter;
+
+  int8_t pinned = 1;
+  if (b->cpus_size > 0) {
+    pinned = b63_cpu_pin(b->cpus[w->index % b->cpus_size]) ||
+             !b->epoch->benchmark->suite->cpus_strict;
+  }
+  /* some counters (lpe, for example) only count the thread creating them */
+  w->counter_ok = pinned && b63_counter_init(&w->counter, main_counter->name,
+                                             main_counter->name +
+                                                 strlen(main_counter->name));
+  if (w->counter_ok) {
+    if (w->counter.type->activate != NULL) {
+      w->counter.type->activate(w->counter.impl);
+    }
+    w->counter.calibration = main_counter->calibration;
+  }
+  w->epoch = *b->epoch;
+  w->epoch.counter = &w->counter;
+  w->epoch.events = 0;
+  w->epoch.fail = !w->counter_ok;
+  w->epoch.bytes = 0;
+  w->epoch.items = 0;
+  int64_t seed = (int64_t)b63_splitmix64((uint64_t)b->seed + w->index);
+
+  __atomic_fetch_add(&b->ready, 1, __ATOMIC_ACQ_REL);
+  b63_mt_spin_until(&b->go, 1);
+
+  if (w->counter_ok) {
+    int64_t started = w->counter.type->read(w->counter.impl);
+    b->fn(&w->epoch, b->n, seed, w->index);
+    int64_t done = w->counter.type->read(w->counter.impl);
+    /* epoch.events is negative here: it's what suspensions subtracted */
+    w->events = done - started + w->epoch.events;
+    b63_counter_cleanup(&w->counter);
+  }
+  return NULL;
+}
+
+/* cpus threads are pinned to: --cpus, or all available */
+static size_t b63_mt_cpus(b63_suite *suite, int **cpus) {
+  static int *available = NULL;
+  static size_t available_size = 0;
+  if (suite->cpus != NULL) {
+    *cpus = suite->cpus;
+    return suite->cpus_size;
+  }
+  if (available == NULL) {
+    available_size = b63_cpu_available(&available);
+  }
+  *cpus = available;
+  return available_size;
+}
+
+/*
+ * Runs one batch on all threads; returns the largest per-thread counter
+ * value, and adds per-thread summary to the epoch.
+ */
+static int64_t b63_mt_run_batch(b63_epoch *e, uint64_t n, int64_t seed,
+                                b63_mt_fn fn) {
+  int32_t threads = e->benchmark->threads;
+  b63_mt_batch batch;
+  memset(&batch, 0, sizeof(batch));
+  batch.epoch = e;
+  batch.fn = fn;
+  batch.n = n;
+  batch.seed = seed;
+  batch.cpus_size = b63_mt_cpus(e->benchmark->suite, &batch.cpus);
+
+  b63_mt_worker *workers =
+      (b63_mt_worker *)calloc(threads, sizeof(b63_mt_worker));
+  if (workers == NULL) {
+    fprintf(stderr, "memory allocation failed for threads\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int32_t i = 0; i < threads; i++) {
+    workers[i].index = i;
+    workers[i].batch = &batch;
+    if (pthread_create(&workers[i].thread, NULL, b63_mt_worker_main,
+                       &workers[i]) != 0) {
+      fprintf(stderr, "unable to create thread %d\n", i);
+      exit(EXIT_FAILURE);
+    }
+  }
+  b63_mt_spin_until(&batch.ready, threads);
+  __atomic_store_n(&batch.go, 1, __ATOMIC_RELEASE);
+
+  int64_t min = 0, max = 0, sum = 0;
+  for (int32_t i = 0; i < threads; i++) {
+    pthread_join(workers[i].thread, NULL);
+    b63_mt_worker *w = &workers[i];
+    e->fail |= w->epoch.fail;
+    if (i == 0 || w->events < min) {
+      min = w->events;
+    }
+    if (i == 0 || w->events > max) {
+      max = w->events;
+    }
+    sum += w->events;
+  }
+  e->thread_min += min;
+  e->thread_sum += sum;
+  e->thread_max += max;
+  e->bytes = threads * workers[0].epoch.bytes;
+  e->items = threads * (workers[0].epoch.items != 0 ? workers[0].epoch.items
+                                                    : 1);
+  free(workers);
+  return max;
+}
+
+/* batch measured by the slowest thread */
+static void b63_mt_measure(b63_epoch *e, uint64_t n, int64_t seed,
+                           int64_t *started, int64_t *done, b63_mt_fn fn) {
+  *started = 0;
+  e->phase_mark = 0;
+  *done = b63_mt_run_batch(e, n, seed, fn);
+}
+
+#define B63_BENCHMARK_MT_IMPL(bname, baseline, iters, nthreads)                \
+  void b63_run_mt_##bname(b63_epoch *, uint64_t, int64_t, int);                \
+  static void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {        \
+    b63_mt_run_batch(e, n, seed, b63_run_mt_##bname);                          \
+  }                                                                            \
+  static void b63_measure_##bname(b63_epoch *e, uint64_t n, int64_t seed,      \
+                                  int64_t *started, int64_t *done) {           \
+    b63_mt_measure(e, n, seed, started, done, b63_run_mt_##bname);             \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = baseline,                                                 \
+      .failed = 0,                                                             \
+      .measure = b63_measure_##bname,                                          \
+      .threads = nthreads,                                                     \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  void b63_run_mt_##bname(b63_epoch *b63run, uint64_t iters, int64_t b63_seed, \
+                          int b63_thread_index)
+
+#define B63_BENCHMARK_MT(name, iters, threads)                                 \
+  B63_BENCHMARK_MT_IMPL(name, 0, iters, threads)
+#define B63_BASELINE_MT(name, iters, threads)                                  \
+  B63_BENCHMARK_MT_IMPL(name, 1, iters, threads)
+
+#endif
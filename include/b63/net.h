@@ -0,0 +1,267 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_NET_H_
+#define _B63_NET_H_
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "fixture.h"
+#include "register.h"
+
+/*
+ * Socket benchmarks, entirely local. B63_NET_PAIR defines a fixture with a
+ * connected pair of sockets, unix (socketpair) or TCP over loopback, and
+ * a peer thread on the other end, which either echoes everything back or
+ * discards it:
+ *
+ * B63_NET_PAIR(echo, B63_NET_TCP, B63_NET_ECHO);
+ *
+ * B63_NET_BENCHMARK(roundtrip, echo) {      // 'echo' is b63_net_pair *
+ *   B63_SET_BYTES(b63run, 4096);
+ *   b63_net_send(echo, 4096);
+ *   b63_net_recv(echo, 4096);
+ * }
+ *
+ * Like B63_IO_BENCHMARK, body is a single operation, so round trips get
+ * p50 .. max latency, messages per second are reported as items and bytes
+ * set with B63_SET_BYTES as GB/s. One operation can send several messages,
+ * for example with sendmmsg; B63_SET_ITEMS overrides the count.
+ *
+ * The body is free to use the descriptor directly, with send, sendmsg and
+ * iovecs or sendmmsg, and buffer as the data. With B63_NET_ZEROCOPY,
+ * send_flags has MSG_ZEROCOPY where the socket supports it (TCP on Linux),
+ * and b63_net_reap needs to be called to consume completion notifications;
+ * b63_net_send does both. Over loopback the kernel does not keep the
+ * pages: zero copy sends fall back to a copy (completions carry
+ * SO_EE_CODE_ZEROCOPY_COPIED), so B63_NET_ZEROCOPY measures the cost of
+ * the MSG_ZEROCOPY path and its notifications, not zero copy itself.
+ * Echoed messages need to fit in socket buffers, otherwise both ends
+ * block on send.
+ */
+
+#define B63_NET_BUFFER (1 << 20)
+
+/* socket kinds */
+#define B63_NET_UNIX 0
+#define B63_NET_TCP 1
+
+/* peer modes and flags */
+#define B63_NET_ECHO 0
+#define B63_NET_SINK 1
+#define B63_NET_ZEROCOPY 2
+
+typedef struct b63_net_pair {
+  /* benchmark end */
+  int fd;
+  /* 0, or MSG_ZEROCOPY if requested and supported */
+  int send_flags;
+  /* B63_NET_BUFFER bytes, free for the body */
+  char *buffer;
+
+  int peer_fd;
+  int8_t echo;
+  char *peer_buffer;
+  pthread_t peer;
+} b63_net_pair;
+
+static int b63_net_send_all(int fd, const char *data, size_t size,
+                            int flags) {
+  while (size > 0) {
+    ssize_t res = send(fd, data, size, flags | MSG_NOSIGNAL);
+    if (res <= 0) {
+      return -1;
+    }
+    data += res;
+    size -= res;
+  }
+  return 0;
+}
+
+static int b63_net_recv_all(int fd, char *data, size_t size) {
+  while (size > 0) {
+    ssize_t res = recv(fd, data, size, 0);
+    if (res <= 0) {
+      return -1;
+    }
+    data += res;
+    size -= res;
+  }
+  return 0;
+}
+
+static void *b63_net_peer(void *arg) {
+  b63_net_pair *p = (b63_net_pair *)arg;
+  for (;;) {
+    ssize_t res = recv(p->peer_fd, p->peer_buffer, B63_NET_BUFFER, 0);
+    if (res <= 0) {
+      break;
+    }
+    if (p->echo && b63_net_send_all(p->peer_fd, p->peer_buffer, res, 0) != 0) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Consumes pending zero copy completions, without waiting for the ones
+ * still in flight. Reusing buffer right after that is only safe because
+ * loopback sends are copied; with real zero copy the body would have to
+ * wait for completion before writing to buffer again.
+ */
+static void b63_net_reap(b63_net_pair *p) {
+#ifdef MSG_ZEROCOPY
+  if (p->send_flags & MSG_ZEROCOPY) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    for (;;) {
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if (recvmsg(p->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+        break;
+      }
+    }
+  }
+#else
+  (void)p;
+#endif
+}
+
+/* sends size bytes of buffer with send_flags */
+static void b63_net_send(b63_net_pair *p, size_t size) {
+  if (b63_net_send_all(p->fd, p->buffer, size, p->send_flags) != 0) {
+    fprintf(stderr, "send failed\n");
+    exit(EXIT_FAILURE);
+  }
+  b63_net_reap(p);
+}
+
+/* receives exactly size bytes into buffer */
+static void b63_net_recv(b63_net_pair *p, size_t size) {
+  if (b63_net_recv_all(p->fd, p->buffer, size) != 0) {
+    fprintf(stderr, "recv failed\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static int b63_net_tcp_connect(int *fd, int *peer_fd) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) {
+    return -1;
+  }
+  int res = -1;
+  if (bind(listener, (struct sockaddr *)&addr, sizeof(addr)) == 0 &&
+      listen(listener, 1) == 0 &&
+      getsockname(listener, (struct sockaddr *)&addr, &len) == 0) {
+    *fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (*fd >= 0 &&
+        connect(*fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+      *peer_fd = accept(listener, NULL, NULL);
+      res = *peer_fd >= 0 ? 0 : -1;
+    }
+  }
+  close(listener);
+  if (res == 0) {
+    int one = 1;
+    setsockopt(*fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(*peer_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  return res;
+}
+
+static void b63_net_pair_create(b63_net_pair *p, int8_t kind, int8_t flags,
+                                int64_t seed) {
+  int fds[2];
+  int res = kind == B63_NET_TCP
+                ? b63_net_tcp_connect(&fds[0], &fds[1])
+                : socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+  p->buffer = (char *)malloc(B63_NET_BUFFER);
+  p->peer_buffer = (char *)malloc(B63_NET_BUFFER);
+  if (res != 0 || p->buffer == NULL || p->peer_buffer == NULL) {
+    fprintf(stderr, "unable to create socket pair\n");
+    exit(EXIT_FAILURE);
+  }
+  p->fd = fds[0];
+  p->peer_fd = fds[1];
+  p->echo = (flags & B63_NET_SINK) == 0;
+  p->send_flags = 0;
+  if (flags & B63_NET_ZEROCOPY) {
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    int one = 1;
+    if (setsockopt(p->fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0) {
+      p->send_flags = MSG_ZEROCOPY;
+    }
+#endif
+    if (p->send_flags == 0) {
+      fprintf(stderr, "MSG_ZEROCOPY is not supported, sending with copy\n");
+    }
+  }
+  for (size_t i = 0; i < B63_NET_BUFFER; i++) {
+    p->buffer[i] = (char)(seed + i);
+  }
+  if (pthread_create(&p->peer, NULL, b63_net_peer, p) != 0) {
+    fprintf(stderr, "unable to start socket peer\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+static void b63_net_pair_destroy(b63_net_pair *p) {
+  /* peer sees end of stream and exits */
+  shutdown(p->fd, SHUT_RDWR);
+  pthread_join(p->peer, NULL);
+  close(p->fd);
+  close(p->peer_fd);
+  free(p->buffer);
+  free(p->peer_buffer);
+}
+
+static void b63_net_teardown_any(void *p, int64_t seed) {
+  (void)seed;
+  b63_net_pair_destroy((b63_net_pair *)p);
+}
+
+#define B63_NET_PAIR(fname, kind, flags)                                       \
+  typedef b63_net_pair b63_fixture_type_##fname;                               \
+  static void b63_setup_any_##fname(void *p, int64_t seed) {                   \
+    b63_net_pair_create((b63_net_pair *)p, kind, flags, seed);                 \
+  }                                                                            \
+  static b63_fixture b63_f_##fname = {                                         \
+      .name = #fname,                                                          \
+      .size = sizeof(b63_net_pair),                                            \
+      .setup = b63_setup_any_##fname,                                          \
+      .teardown = b63_net_teardown_any,                                        \
+  }
+
+#define B63_NET_BASELINE(name, pair) B63_IO_BENCHMARK_IMPL(name, pair, 1)
+#define B63_NET_BENCHMARK(name, pair) B63_IO_BENCHMARK_IMPL(name, pair, 0)
+
+#endif
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_NOISE_H_
+#define _B63_NOISE_H_
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "cache.h"
+#include "cpu.h"
+
+/*
+ * Noisy neighbors (--noise): aggressor processes running next to the
+ * benchmark, each pinned to its own cpu:
+ *  - spin: integer ALU loop, competes for execution ports on SMT sibling;
+ *  - llc-thrash: scattered writes over twice the last level cache;
+ *  - membw: sequential writes and reads over 8x last level cache;
+ *  - branch-storm: random conditional and indirect branches.
+ *
+ * Spec is a list of kind:count, for example llc-thrash:2,membw:4, and
+ * smt-sibling:kind for one aggressor on SMT sibling of the measurement cpu.
+ * Other aggressors go to cpus from --noise-cpus, or to available cpus on
+ * other cores than the measurement one, round robin.
+ *
+ * Every benchmark is measured quietly first and then again while
+ * aggressors run, and reported as name/noisy compared to the quiet run.
+ */
+
+enum {
+  B63_NOISE_SPIN = 0,
+  B63_NOISE_LLC,
+  B63_NOISE_MEMBW,
+  B63_NOISE_BRANCH,
+  B63_NOISE_KINDS
+};
+
+static const char *b63_noise_names[B63_NOISE_KINDS] = {"spin", "llc-thrash",
+                                                       "membw", "branch-storm"};
+
+#define B63_NOISE_MAX 64
+/* cpu of aggressors which have nowhere to run */
+#define B63_NOISE_SKIP -2
+
+typedef struct b63_noise {
+  int8_t kinds[B63_NOISE_MAX];
+  int8_t sibling[B63_NOISE_MAX];
+  /* cpu per aggressor, -1 if not pinned, B63_NOISE_SKIP if not started */
+  int cpus[B63_NOISE_MAX];
+  size_t size;
+  /* from --noise-cpus, NULL if not set */
+  int *pool;
+  size_t pool_size;
+  pid_t pids[B63_NOISE_MAX];
+  /* number of aggressors done with setup, shared with them */
+  int32_t *ready;
+} b63_noise;
+
+static int b63_noise_kind(const char *name, size_t len) {
+  for (int k = 0; k < B63_NOISE_KINDS; k++) {
+    if (strlen(b63_noise_names[k]) == len &&
+        strncmp(b63_noise_names[k], name, len) == 0) {
+      return k;
+    }
+  }
+  return -1;
+}
+
+/* parses spec into n, returns 0 on error */
+static int8_t b63_noise_parse(b63_noise *n, const char *spec) {
+  memset(n, 0, sizeof(b63_noise));
+  const char *p = spec;
+  while (*p != '\0') {
+    const char *end = strchr(p, ',');
+    size_t len = end != NULL ? (size_t)(end - p) : strlen(p);
+    const char *colon = (const char *)memchr(p, ':', len);
+    size_t name_len = colon != NULL ? (size_t)(colon - p) : len;
+    const char *arg = colon != NULL ? colon + 1 : NULL;
+    size_t arg_len = colon != NULL ? len - name_len - 1 : 0;
+
+    int8_t sibling = name_len == 11 && strncmp(p, "smt-sibling", 11) == 0;
+    int kind;
+    long count = 1;
+    if (sibling) {
+      kind = arg != NULL ? b63_noise_kind(arg, arg_len) : B63_NOISE_SPIN;
+    } else {
+      kind = b63_noise_kind(p, name_len);
+      if (arg != NULL) {
+        char *e;
+        count = strtol(arg, &e, 10);
+        if (e != arg + arg_len || count < 1) {
+          return 0;
+        }
+      }
+    }
+    if (kind < 0 || n->size + count > B63_NOISE_MAX) {
+      return 0;
+    }
+    for (long i = 0; i < count; i++) {
+      n->kinds[n->size] = (int8_t)kind;
+      n->sibling[n->size] = sibling;
+      n->size++;
+    }
+    p += len;
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return n->size > 0;
+}
+
+/* first SMT sibling of the cpu, -1 if there is none */
+static int b63_noise_sibling(int cpu) {
+  char path[128];
+  int *siblings, res = -1;
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  size_t size = b63_cpu_list_read(path, &siblings);
+  for (size_t i = 0; i < size && res < 0; i++) {
+    if (siblings[i] != cpu) {
+      res = siblings[i];
+    }
+  }
+  free(siblings);
+  return res;
+}
+
+/* assigns cpus to aggressors, cpu is the one measurement is pinned to */
+static void b63_noise_place(b63_noise *n, int cpu) {
+  int *pool = n->pool;
+  size_t pool_size = n->pool_size;
+  if (pool == NULL) {
+    int *available;
+    size_t size = b63_cpu_available(&available);
+    pool = available;
+    for (size_t i = 0; i < size; i++) {
+      if (b63_cpu_core(available[i]) != b63_cpu_core(cpu)) {
+        pool[pool_size++] = available[i];
+      }
+    }
+  }
+  size_t next = 0;
+  for (size_t i = 0; i < n->size; i++) {
+    if (n->sibling[i]) {
+      n->cpus[i] = b63_noise_sibling(cpu);
+      if (n->cpus[i] < 0) {
+        fprintf(stderr, "noise: cpu %d has no SMT sibling, skipping %s\n",
+                cpu, b63_noise_names[n->kinds[i]]);
+        n->cpus[i] = B63_NOISE_SKIP;
+      }
+    } else if (pool_size > 0) {
+      n->cpus[i] = pool[next++ % pool_size];
+    } else {
+      n->cpus[i] = -1;
+    }
+  }
+  if (pool_size == 0) {
+    fprintf(stderr, "noise: no spare cpus, aggressors are not pinned\n");
+  }
+  if (pool != n->pool) {
+    free(pool);
+  }
+}
+
+typedef int64_t (*b63_noise_fn)(uint64_t);
+
+static int64_t b63_noise_f0(uint64_t x) { return (int64_t)(x >> 3); }
+static int64_t b63_noise_f1(uint64_t x) { return (int64_t)(x ^ 0x5bd1e995); }
+static int64_t b63_noise_f2(uint64_t x) { return (int64_t)(x * 3); }
+static int64_t b63_noise_f3(uint64_t x) { return (int64_t)(x + 7); }
+
+/* aggressor process body, never returns */
+static void b63_noise_run(int8_t kind, int32_t *ready) {
+  char *buf = NULL;
+  size_t size = 0;
+  if (kind == B63_NOISE_LLC || kind == B63_NOISE_MEMBW) {
+    int64_t llc = b63_cache_size(0);
+    size = (size_t)(llc > 0 ? llc : B63_CACHE_DEFAULT_LLC) *
+           (kind == B63_NOISE_LLC ? 2 : 8);
+    buf = (char *)malloc(size);
+    if (buf == NULL) {
+      _exit(EXIT_FAILURE);
+    }
+    memset(buf, 1, size);
+  }
+  __atomic_fetch_add(ready, 1, __ATOMIC_ACQ_REL);
+
+  static const b63_noise_fn fns[] = {b63_noise_f0, b63_noise_f1, b63_noise_f2,
+                                     b63_noise_f3};
+  const size_t lines = size / B63_CACHE_LINE;
+  uint64_t x = 88172645463325252ULL;
+  int64_t sink = 0;
+  size_t line = 0;
+  for (;;) {
+    switch (kind) {
+    case B63_NOISE_SPIN:
+      for (int i = 0; i < 1024; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      }
+      sink += (int64_t)x;
+      break;
+    case B63_NOISE_LLC:
+      /* large prime stride defeats the prefetcher */
+      for (int i = 0; i < 1024; i++) {
+        line = (line + 4099) % lines;
+        buf[line * B63_CACHE_LINE]++;
+      }
+      break;
+    case B63_NOISE_MEMBW:
+      memset(buf, (int)(x++ & 0x7f), size);
+      sink += b63_cache_read(buf, size, sizeof(int64_t));
+      break;
+    case B63_NOISE_BRANCH:
+      for (int i = 0; i < 1024; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        if (x & 1) {
+          sink += fns[(x >> 1) & 3](x);
+        } else if (x & 2) {
+          sink -= fns[(x >> 2) & 3](x);
+        }
+        __asm__ __volatile__("" ::"r"(sink));
+      }
+      break;
+    }
+    __asm__ __volatile__("" ::"m"(sink));
+  }
+}
+
+/* starts aggressors and waits until they are ready */
+static void b63_noise_start(b63_noise *n) {
+  n->ready = (int32_t *)mmap(NULL, sizeof(int32_t), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (n->ready == MAP_FAILED) {
+    fprintf(stderr, "memory allocation failed for noise\n");
+    exit(EXIT_FAILURE);
+  }
+  *n->ready = 0;
+  int32_t started = 0;
+  fflush(stdout);
+  for (size_t i = 0; i < n->size; i++) {
+    n->pids[i] = 0;
+    if (n->cpus[i] == B63_NOISE_SKIP) {
+      continue;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      fprintf(stderr, "unable to start noise process\n");
+      exit(EXIT_FAILURE);
+    }
+    if (pid == 0) {
+#ifdef __linux__
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      /* unpinned aggressor would not interfere the way it was placed */
+      if (n->cpus[i] >= 0 && !b63_cpu_pin(n->cpus[i])) {
+        _exit(EXIT_FAILURE);
+      }
+#endif
+      b63_noise_run(n->kinds[i], n->ready);
+    }
+    n->pids[i] = pid;
+    started++;
+  }
+  while (__atomic_load_n(n->ready, __ATOMIC_ACQUIRE) < started) {
+    for (size_t i = 0; i < n->size; i++) {
+      if (n->pids[i] > 0 && waitpid(n->pids[i], NULL, WNOHANG) == n->pids[i]) {
+        fprintf(stderr, "noise process failed: %s\n",
+                b63_noise_names[n->kinds[i]]);
+        exit(EXIT_FAILURE);
+      }
+    }
+    usleep(1000);
+  }
+}
+
+static void b63_noise_stop(b63_noise *n) {
+  for (size_t i = 0; i < n->size; i++) {
+    if (n->pids[i] > 0) {
+      kill(n->pids[i], SIGKILL);
+      waitpid(n->pids[i], NULL, 0);
+      n->pids[i] = 0;
+    }
+  }
+  munmap(n->ready, sizeof(int32_t));
+  n->ready = NULL;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_PHASE_H_
+#define _B63_PHASE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "counter.h"
+
+/*
+ * B63_PHASE splits the benchmark body into named parts, each reported
+ * separately as 'benchmark/phase':
+ *
+ * B63_BENCHMARK(pipeline, n) {
+ *   for (int i = 0; i < n; i++) {
+ *     B63_PHASE("parse") { ... }
+ *     B63_PHASE("transform") { ... }
+ *     B63_PHASE("serialize") { ... }
+ *   }
+ * }
+ *
+ * Phases are marks: entering a phase reads the counter once, and all
+ * events since the previous mark go to the previous phase. Events after
+ * the block still belong to the phase until the next mark or the end of
+ * the batch, and events before the first mark are reported as
+ * 'benchmark/other', so phases always sum up to the benchmark total.
+ */
+
+/*
+ * Slot of phase 'name' in epoch e, registering it on the first entry.
+ * Names are usually string literals, so pointers are compared first.
+ */
+static inline int8_t b63_phase_index(b63_epoch *e, const char *name) {
+  for (int8_t i = 1; i <= e->phases_size; i++) {
+    if (e->phase_names[i] == name) {
+      return i;
+    }
+  }
+  for (int8_t i = 1; i <= e->phases_size; i++) {
+    if (strcmp(e->phase_names[i], name) == 0) {
+      return i;
+    }
+  }
+  if (e->phases_size == B63_MAX_PHASES) {
+    fprintf(stderr, "too many phases, at most %d are supported\n",
+            B63_MAX_PHASES);
+    exit(EXIT_FAILURE);
+  }
+  e->phase_names[++e->phases_size] = name;
+  return e->phases_size;
+}
+
+static inline void b63_phase_enter(b63_epoch *e, const char *name) {
+  b63_counter *c = e->counter;
+  int64_t now = c->type->read(c->impl);
+  e->phase_events[e->phase] += now - e->phase_mark;
+  e->phase_mark = now;
+  e->phase = b63_phase_index(e, name);
+}
+
+#define B63_PHASE(name)                                                        \
+  for (int8_t b63_phase_once = (b63_phase_enter(b63run, name), 1);             \
+       b63_phase_once; b63_phase_once = 0)
+
+#endif
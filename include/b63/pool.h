@@ -0,0 +1,167 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_POOL_H_
+#define _B63_POOL_H_
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "data.h"
+#include "fixture.h"
+
+/*
+ * Input pools: K distinct inputs, generated per seed outside of measurement,
+ * handed to the benchmark one per iteration in shuffled order. Running the
+ * same input on every iteration lets branch predictors and prefetchers
+ * learn it, which makes results look better than production.
+ *
+ * typedef struct { int32_t key; } query_t;
+ *
+ * B63_INPUT_POOL(queries, query_t, 1024) {   // 'queries' is query_t *
+ *   queries->key = rand_from(b63_seed);       // seed differs per input
+ * }
+ *
+ * B63_BENCHMARK_POOL(lookup, queries, n) {
+ *   for (uint64_t i = 0; i < n; i++) {
+ *     query_t *q = B63_INPUT_NEXT(queries);
+ *     ...
+ *   }
+ * }
+ *
+ * The benchmark is a family over the pool size, K = 1, 16, 256, ... up to
+ * the count, reported as name/K, so it's visible how much of the result
+ * comes from the predictor learning the input. -a overrides the sizes.
+ */
+
+typedef struct b63_input_pool {
+  /* count inputs of input_size bytes */
+  char *inputs;
+  size_t input_size;
+  int64_t count;
+  /* order in which inputs are handed out, shuffled per seed */
+  uint32_t *order;
+  int64_t pos;
+} b63_input_pool;
+
+static void b63_pool_build(b63_input_pool *p, size_t input_size, int64_t count,
+                           int64_t seed, b63_fixture_fn generate) {
+  if (count < 1 || count > UINT32_MAX) {
+    fprintf(stderr, "invalid input pool size: %" PRId64 "\n", count);
+    exit(EXIT_FAILURE);
+  }
+  p->input_size = input_size;
+  p->count = count;
+  p->pos = 0;
+  p->inputs = (char *)calloc(count, input_size);
+  p->order = (uint32_t *)malloc(count * sizeof(uint32_t));
+  if (p->inputs == NULL || p->order == NULL) {
+    fprintf(stderr, "memory allocation failed for input pool\n");
+    exit(EXIT_FAILURE);
+  }
+  uint64_t state = (uint64_t)seed;
+  for (int64_t i = 0; i < count; i++) {
+    state = b63_splitmix64(state);
+    generate(p->inputs + i * input_size, (int64_t)state);
+    p->order[i] = (uint32_t)i;
+  }
+  /* Fisher-Yates */
+  for (int64_t i = count - 1; i > 0; i--) {
+    state = b63_splitmix64(state);
+    int64_t j = (int64_t)(state % (uint64_t)(i + 1));
+    uint32_t t = p->order[i];
+    p->order[i] = p->order[j];
+    p->order[j] = t;
+  }
+}
+
+static void b63_pool_destroy(b63_input_pool *p, b63_fixture_fn teardown,
+                             int64_t seed) {
+  if (teardown != NULL) {
+    for (int64_t i = 0; i < p->count; i++) {
+      teardown(p->inputs + i * p->input_size, seed);
+    }
+  }
+  free(p->inputs);
+  free(p->order);
+}
+
+/* next input; cost of this is part of measurement, same for every K */
+static inline void *b63_input_next(b63_input_pool *p) {
+  void *res = p->inputs + p->input_size * p->order[p->pos];
+  if (++p->pos == p->count) {
+    p->pos = 0;
+  }
+  return res;
+}
+
+/*
+ * Pool is a per-seed fixture of b63_input_pool type, with pool size as the
+ * fixture parameter (benchmark argument); it's rebuilt when either changes.
+ * Without argument, as in B63_BENCHMARK_F, pool has pcount inputs.
+ */
+#define B63_INPUT_POOL(pname, type, pcount)                                    \
+  typedef type b63_input_type_##pname;                                         \
+  typedef b63_input_pool b63_fixture_type_##pname;                             \
+  enum { b63_input_count_##pname = pcount };                                   \
+  static void b63_generate_##pname(type *, int64_t);                           \
+  static void b63_generate_any_##pname(void *in, int64_t seed) {               \
+    b63_generate_##pname((type *)in, seed);                                    \
+  }                                                                            \
+  static void b63_pool_setup_##pname(void *, int64_t);                         \
+  static void b63_pool_teardown_##pname(void *, int64_t);                      \
+  static b63_fixture b63_f_##pname = {                                         \
+      .name = #pname,                                                          \
+      .size = sizeof(b63_input_pool),                                          \
+      .setup = b63_pool_setup_##pname,                                         \
+      .teardown = b63_pool_teardown_##pname,                                   \
+      .per_seed = 1,                                                           \
+      .pool = 1,                                                               \
+  };                                                                           \
+  static void b63_pool_setup_##pname(void *p, int64_t seed) {                  \
+    int64_t count = b63_f_##pname.param;                                       \
+    b63_pool_build((b63_input_pool *)p, sizeof(type),                          \
+                   count > 0 ? count : b63_input_count_##pname, seed,          \
+                   b63_generate_any_##pname);                                  \
+  }                                                                            \
+  static void b63_pool_teardown_##pname(void *p, int64_t seed) {               \
+    b63_pool_destroy((b63_input_pool *)p, b63_f_##pname.input_teardown, seed); \
+  }                                                                            \
+  static void b63_generate_##pname(type *pname, int64_t b63_seed)
+
+/* optional, called for every input when pool is destroyed */
+#define B63_INPUT_TEARDOWN(pname)                                              \
+  static void b63_input_teardown_##pname(b63_input_type_##pname *, int64_t);   \
+  static void b63_input_teardown_any_##pname(void *in, int64_t seed) {         \
+    b63_input_teardown_##pname((b63_input_type_##pname *)in, seed);            \
+  }                                                                            \
+  static b63_fixture_hook b63_fh_input_teardown_##pname = {                    \
+      .fixture = &b63_f_##pname,                                               \
+      .kind = B63_FIXTURE_INPUT_TEARDOWN,                                      \
+      .fn = b63_input_teardown_any_##pname,                                    \
+  };                                                                           \
+  B63_LIST_ADD(b63_fixture_hook, fixture_input_teardown_##pname,               \
+               &b63_fh_input_teardown_##pname);                                \
+  static void b63_input_teardown_##pname(b63_input_type_##pname *pname,        \
+                                         int64_t b63_seed)
+
+/* next input from the pool, as pointer to the input type */
+#define B63_INPUT_NEXT(pname)                                                  \
+  ((b63_input_type_##pname *)b63_input_next(pname))
+
+#endif
@@ -19,6 +19,9 @@
 
 #include "benchmark.h"
 #include "suite.h"
+#include "throughput.h"
+#include "utils/complexity.h"
+#include "utils/scaling.h"
 #include "utils/stats.h"
 
 #include <inttypes.h>
@@ -28,44 +31,223 @@ const char *B63_CLR_RED = "\033[0;31m";
 const char *B63_CLR_GREEN = "\033[0;32m";
 const char *B63_CLR_RESET = "\033[0m";
 
-static void b63_print_individual(b63_benchmark *bm, const char *counter,
-                                 b63_stats *tt) {
+/* with --precision or --budget, number of epochs differs, so it's printed too */
+static void b63_print_epochs(b63_benchmark *bm, b63_stats *tt) {
+  if (bm->suite->precision > 0.0 || bm->suite->budget_s > 0) {
+    printf(" [%" PRId64 " epochs, +-%.3lf%%]", tt->n,
+           100.0 * b63_stats_interval(tt) /
+               fabs((bm->is_baseline || bm->suite->baseline == NULL
+                         ? tt->sum_test
+                         : tt->sum_base) /
+                    tt->n));
+  }
+  printf("\n");
+}
+
+/* name is reported name of the row: benchmark name or benchmark/part */
+static void b63_print_individual(b63_benchmark *bm, const char *name,
+                                 const char *counter, b63_stats *tt) {
   if (bm->suite->printer_config.plaintext != 0) {
     return;
   }
   if (bm->failed) {
     printf("%s%-30s%-20s: assertion fail%s\n", B63_CLR_RED,
-           bm->name, counter, B63_CLR_RESET);
+           name, counter, B63_CLR_RESET);
     return;
   }
-  printf("%-30s%-20s: %6.3lf\n", bm->name, counter, tt->sum_test / tt->n);
+  printf("%-30s%-20s: %6.3lf", name, counter, tt->sum_test / tt->n);
+  b63_print_epochs(bm, tt);
 }
 
-static void b63_print_comparison(b63_benchmark *bm, const char *counter,
-                                 b63_stats *tt) {
+/* for throughput higher values are better, so colors are reversed */
+static void b63_print_comparison_dir(b63_benchmark *bm, const char *name,
+                                     const char *counter, b63_stats *tt,
+                                     int8_t higher_is_better) {
   if (bm->suite->printer_config.plaintext != 0) {
     return;
   }
   if (bm->failed) {
     printf("%s%-30s%-20s: assertion fail%s\n", B63_CLR_RED,
-           bm->name, counter, B63_CLR_RESET);
+           name, counter, B63_CLR_RESET);
     return;
   }
   double d = b63_stats_diff(tt);
   double percentage_diff = b63_stats_percentage_diff(tt);
-  double interval99 = b63_stats_99_interval(tt);
-  double a = d - interval99;
-  double b = d + interval99;
+  double interval = b63_stats_interval(tt);
+  double a = d - interval;
+  double b = d + interval;
   const char *c = B63_CLR_RESET;
   char confident = ' ';
   /* confidense interval outside of 0 */
   if (a * b > 0) {
-    c = d < 0 ? B63_CLR_GREEN : B63_CLR_RED;
+    c = (d < 0) != higher_is_better ? B63_CLR_GREEN : B63_CLR_RED;
     confident = '*';
   }
-  printf("%-30s%-20s: %s%6.3lf (%+6.3lf%% %c)%s\n", bm->name, counter, c,
+  printf("%-30s%-20s: %s%6.3lf (%+6.3lf%% %c)%s", name, counter, c,
          tt->sum_test / tt->n, percentage_diff, confident, B63_CLR_RESET);
+  b63_print_epochs(bm, tt);
+
+  fflush(stdout);
+}
+
+static void b63_print_comparison(b63_benchmark *bm, const char *name,
+                                 const char *counter, b63_stats *tt) {
+  b63_print_comparison_dir(bm, name, counter, tt, 0);
+}
+
+static void b63_print_calibration(b63_suite *suite, b63_counter *counter) {
+  if (suite->printer_config.plaintext != 0) {
+    return;
+  }
+  b63_calibration *cal = &counter->calibration;
+  printf("%-30s%-20s: batch %" PRId64 " +- %" PRId64 ", suspend %" PRId64
+         " +- %" PRId64 ", step %" PRId64 "\n",
+         "[calibration]", counter->name, cal->batch, cal->batch_mad,
+         cal->suspension, cal->suspension_mad, cal->step);
+  fflush(stdout);
+}
+
+static void b63_print_complexity(b63_benchmark *family, const char *counter,
+                                 int model, double coef, double rms) {
+  if (family->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/BigO", family->name);
+  printf("%-30s%-20s: %6.4lg %s (rms %.1lf%%)\n", name, counter, coef,
+         b63_complexity_names[model], 100.0 * rms);
+  fflush(stdout);
+}
+
+/*
+ * How much the result depends on input pool size: ratio of the last
+ * instance (the largest pool by default) to the first one (single input).
+ */
+static void b63_print_pool_sensitivity(b63_benchmark *family,
+                                       const char *counter, const double *k,
+                                       const double *y, size_t size) {
+  if (family->suite->printer_config.plaintext != 0 || size < 2 || y[0] <= 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/pool", family->name);
+  printf("%-30s%-20s: x%.3lf (K=%.0lf vs K=%.0lf)\n", name, counter,
+         y[size - 1] / y[0], k[size - 1], k[0]);
+  fflush(stdout);
+}
 
+/* speedup of one thread count relative to the smallest one, see --scale */
+static void b63_print_speedup(b63_benchmark *bm, const char *counter,
+                              double speedup, double n) {
+  if (bm->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/scaling", bm->name);
+  printf("%-30s%-20s: x%.3lf, efficiency %.1lf%%\n", name, counter, speedup,
+         100.0 * speedup / n);
+  fflush(stdout);
+}
+
+/*
+ * Non-time counter of one thread count relative to the smallest one, per
+ * thread and iteration, see --scale
+ */
+static void b63_print_scaling_ratio(b63_benchmark *bm, const char *counter,
+                                    double ratio, int threads) {
+  if (bm->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/scaling", bm->name);
+  printf("%-30s%-20s: x%.3lf per thread vs t%d\n", name, counter,
+         ratio, threads);
+  fflush(stdout);
+}
+
+/* ISA variant relative to the first target of B63_BENCHMARK_ISA */
+static void b63_print_isa_speedup(b63_benchmark *bm, const char *counter,
+                                  double speedup) {
+  if (bm->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/speedup", bm->name);
+  printf("%-30s%-20s: x%.3lf vs %s\n", name, counter, speedup,
+         bm->isa_default->isa);
+  fflush(stdout);
+}
+
+/*
+ * Contention (sigma) and coherency (kappa) fitted over thread counts,
+ * with the thread count of peak throughput if USL predicts one.
+ */
+static void b63_print_scaling(b63_benchmark *family, const char *counter,
+                              const b63_scaling *s, int threads) {
+  if (family->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/amdahl", family->name);
+  printf("%-30s%-20s: sigma %.4lf (rms %.1lf%%)\n", name, counter,
+         s->amdahl_sigma, 100.0 * s->amdahl_rms);
+  if (s->usl) {
+    snprintf(name, sizeof(name), "%s/usl", family->name);
+    printf("%-30s%-20s: sigma %.4lf, kappa %.5lf", name, counter, s->sigma,
+           s->kappa);
+    double peak = b63_scaling_peak(s);
+    if (peak > 0.0) {
+      printf(", peak at %.1lf threads", peak * threads);
+    }
+    printf(" (rms %.1lf%%)\n", 100.0 * s->rms);
+  }
+  fflush(stdout);
+}
+
+/*
+ * Highest offered load served without latency going up, see --load.
+ * knee is NULL if even the lightest load is past it.
+ */
+static void b63_print_knee(b63_benchmark *family, b63_benchmark *knee,
+                           b63_benchmark *heaviest) {
+  if (family->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/knee", family->name);
+  if (knee == NULL) {
+    printf("%-30s%-20s: below %" PRId64 "\n", name, "ops/s", heaviest->rate);
+  } else if (knee == heaviest) {
+    printf("%-30s%-20s: above %" PRId64 " (p99 %.1lf ns)\n", name, "ops/s",
+           knee->rate, knee->p99);
+  } else {
+    printf("%-30s%-20s: %" PRId64 " (p99 %.1lf ns, achieved %.0lf)\n", name,
+           "ops/s", knee->rate, knee->p99, knee->achieved);
+  }
+  fflush(stdout);
+}
+
+/* hash of all reported results, deterministic mode only */
+static void b63_print_hash(b63_suite *suite) {
+  if (suite->printer_config.plaintext != 0) {
+    printf("[hash]%c%016" PRIx64 "\n", suite->printer_config.delimiter,
+           suite->hash);
+  } else {
+    printf("%-30s%-20s: %016" PRIx64 "\n", "[hash]", "results", suite->hash);
+  }
+  fflush(stdout);
+}
+
+/* time spent evicting caches between batches, excluded from results */
+static void b63_print_excluded(b63_benchmark *bm, int64_t excluded_ns,
+                               int64_t batches) {
+  if (bm->suite->printer_config.plaintext != 0) {
+    return;
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/eviction", bm->name);
+  printf("%-30s%-20s: %.3lf s excluded, %" PRId64 " batches\n", name,
+         "time", excluded_ns / 1e9, batches);
   fflush(stdout);
 }
 
@@ -78,6 +260,50 @@ static void b63_print_done(b63_epoch *r) {
            1.0 * r->events / r->iterations);
     fflush(stdout);
   }
+  b63_suite *suite = r->benchmark->suite;
+  /* throughput: amount per iteration and amount per event */
+  for (int k = 0; k < B63_THROUGHPUT_KINDS; k++) {
+    if (suite->printer_config.plaintext != 0 && b63_throughput_amount(r, k)) {
+      char d = suite->printer_config.delimiter;
+      printf("%s/%s%c%s%c%" PRId64 "%c%" PRId64 "%c%lf\n", r->benchmark->name,
+             b63_throughput_names[k], d, r->counter->name, d, r->iterations, d,
+             b63_throughput_amount(r, k), d, b63_throughput_raw(r, k));
+    }
+  }
+  /* benchmarks with phases: one more row per phase */
+  if (suite->printer_config.plaintext != 0 && r->phases_size > 0) {
+    char d = suite->printer_config.delimiter;
+    for (int8_t i = 1; i <= r->phases_size + 1; i++) {
+      int8_t p = i % (r->phases_size + 1);
+      printf("%s/%s%c%s%c%" PRId64 "%c%" PRId64 "%c%lf\n", r->benchmark->name,
+             r->phase_names[p], d, r->counter->name, d, r->iterations, d,
+             r->phase_events[p], d, 1.0 * r->phase_events[p] / r->iterations);
+    }
+    fflush(stdout);
+  }
+  /* multithreaded benchmarks: fastest, total and slowest thread */
+  if (suite->printer_config.plaintext != 0 && r->benchmark->threads > 0) {
+    char d = suite->printer_config.delimiter;
+    const char *names[] = {"thread_min", "thread_sum", "thread_max"};
+    int64_t values[] = {r->thread_min, r->thread_sum, r->thread_max};
+    for (int i = 0; i < 3; i++) {
+      printf("%s/%s%c%s%c%" PRId64 "%c%" PRId64 "%c%lf\n", r->benchmark->name,
+             names[i], d, r->counter->name, d, r->iterations, d, values[i], d,
+             1.0 * values[i] / r->iterations);
+    }
+    fflush(stdout);
+  }
+  /* latency benchmarks: one more row, for the first counter only */
+  if (suite->printer_config.plaintext != 0 && r->benchmark->latency &&
+      r->counter == suite->counter_list.data) {
+    char d = suite->printer_config.delimiter;
+    printf("%s%clatency_ns", r->benchmark->name, d);
+    for (int i = 0; i < B63_LATENCY_VALUES; i++) {
+      printf("%c%lf", d, r->latency[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+  }
 }
 
 #endif
@@ -18,8 +18,16 @@
 #define _B63_REGISTER_H_
 
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 #include "benchmark.h"
+#include "fixture.h"
+#include "io.h"
+#include "isa.h"
+#include "latency.h"
+#include "pool.h"
+#include "throughput.h"
 #include "utils/section_ptr_list.h"
 
 /*
@@ -32,6 +40,27 @@
  */
 
 B63_LIST_DECLARE(b63_benchmark)
+/* keeps the section non-empty for binaries only running --exec commands */
+B63_LIST_ADD(b63_benchmark, b63_benchmark_none, NULL)
+
+/*
+ * Benchmarks can also be registered at runtime, before the suite starts,
+ * for example from C++ layer (b63.hpp). They are run together with the
+ * ones from the section list.
+ */
+static b63_benchmark **b63_runtime_benchmarks = NULL;
+static size_t b63_runtime_benchmarks_size = 0;
+
+static void b63_register(b63_benchmark *b) {
+  b63_runtime_benchmarks = (b63_benchmark **)realloc(
+      b63_runtime_benchmarks,
+      (b63_runtime_benchmarks_size + 1) * sizeof(b63_benchmark *));
+  if (b63_runtime_benchmarks == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark registration\n");
+    exit(EXIT_FAILURE);
+  }
+  b63_runtime_benchmarks[b63_runtime_benchmarks_size++] = b;
+}
 
 #define B63_BENCHMARK_IMPL(bname, baseline, iters)                             \
   void b63_run_##bname(b63_epoch *, uint64_t, int64_t);                        \
@@ -51,4 +80,187 @@ B63_LIST_DECLARE(b63_benchmark)
 #define B63_BASELINE(name, iters) B63_BENCHMARK_IMPL(name, 1, iters)
 #define B63_BENCHMARK(name, iters) B63_BENCHMARK_IMPL(name, 0, iters)
 
+/*
+ * Benchmarks using a fixture (see fixture.h); pointer to the fixture data
+ * is available under the fixture name.
+ */
+#define B63_BENCHMARK_F_IMPL(bname, fname, baseline, iters)                    \
+  void b63_run_f_##bname(b63_epoch *, uint64_t, int64_t,                       \
+                         b63_fixture_type_##fname *);                          \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    b63_run_f_##bname(                                                         \
+        e, n, seed, (b63_fixture_type_##fname *)e->benchmark->fixture->data);  \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = baseline,                                                 \
+      .failed = 0,                                                             \
+      .fixture = &b63_f_##fname,                                               \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  void b63_run_f_##bname(b63_epoch *b63run, uint64_t iters, int64_t b63_seed,  \
+                         b63_fixture_type_##fname *fname)
+
+/*
+ * Benchmark using input pool (see pool.h), registered as a family over
+ * pool size: 1, 16, 256, ... up to the pool count, reported as name/K.
+ */
+#define B63_BENCHMARK_POOL(bname, pname, iters)                                \
+  void b63_run_f_##bname(b63_epoch *, uint64_t, int64_t, b63_input_pool *);    \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    b63_run_f_##bname(e, n, seed,                                              \
+                      (b63_input_pool *)e->benchmark->fixture->data);          \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = 0,                                                        \
+      .failed = 0,                                                             \
+      .fixture = &b63_f_##pname,                                               \
+      .args_size = 1,                                                          \
+      .ranges = {{1, b63_input_count_##pname, 16}},                            \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  void b63_run_f_##bname(b63_epoch *b63run, uint64_t iters, int64_t b63_seed,  \
+                         b63_input_pool *pname)
+
+#define B63_BASELINE_F(name, fixture, iters)                                   \
+  B63_BENCHMARK_F_IMPL(name, fixture, 1, iters)
+#define B63_BENCHMARK_F(name, fixture, iters)                                  \
+  B63_BENCHMARK_F_IMPL(name, fixture, 0, iters)
+
+/*
+ * Latency benchmarks: body is a single operation, and the framework runs
+ * the loop, timing operations individually. Reported as p50, p90, p99,
+ * p999 and max in nanoseconds, in addition to counter values per operation.
+ *
+ * B63_LATENCY_BENCHMARK(push) {
+ *   ... one operation; b63run and b63_seed are available ...
+ * }
+ */
+#define B63_LATENCY_BENCHMARK_IMPL(bname, baseline)                            \
+  static inline __attribute__((always_inline)) void b63_op_##bname(            \
+      b63_epoch *, int64_t);                                                   \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    B63_LATENCY_LOOP(b63_op_##bname, e, n, seed,                               \
+                     e->benchmark->suite->latency_sample);                     \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = baseline,                                                 \
+      .failed = 0,                                                             \
+      .latency = 1,                                                            \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  static inline __attribute__((always_inline)) void b63_op_##bname(            \
+      b63_epoch *b63run, int64_t b63_seed)
+
+#define B63_LATENCY_BASELINE(name) B63_LATENCY_BENCHMARK_IMPL(name, 1)
+#define B63_LATENCY_BENCHMARK(name) B63_LATENCY_BENCHMARK_IMPL(name, 0)
+
+/*
+ * I/O benchmarks: latency benchmark with a fixture, one operation per
+ * iteration, counted as an item; used with files from B63_IO_FILE (see io.h)
+ * and sockets from B63_NET_PAIR (see net.h).
+ *
+ * B63_IO_BENCHMARK(read_4k, data) {
+ *   ... one operation on data->fd; b63run and b63_seed are available ...
+ * }
+ */
+#define B63_IO_BENCHMARK_IMPL(bname, fname, baseline)                          \
+  static inline __attribute__((always_inline)) void b63_io_op_##bname(         \
+      b63_epoch *, int64_t, b63_fixture_type_##fname *);                       \
+  static inline __attribute__((always_inline)) void b63_op_##bname(            \
+      b63_epoch *e, int64_t seed) {                                            \
+    b63_io_op_##bname(                                                         \
+        e, seed, (b63_fixture_type_##fname *)e->benchmark->fixture->data);     \
+  }                                                                            \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    B63_SET_ITEMS(e, 1);                                                       \
+    B63_LATENCY_LOOP(b63_op_##bname, e, n, seed,                               \
+                     e->benchmark->suite->latency_sample);                     \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = baseline,                                                 \
+      .failed = 0,                                                             \
+      .latency = 1,                                                            \
+      .fixture = &b63_f_##fname,                                               \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  static inline __attribute__((always_inline)) void b63_io_op_##bname(         \
+      b63_epoch *b63run, int64_t b63_seed, b63_fixture_type_##fname *fname)
+
+#define B63_IO_BASELINE(name, file) B63_IO_BENCHMARK_IMPL(name, file, 1)
+#define B63_IO_BENCHMARK(name, file) B63_IO_BENCHMARK_IMPL(name, file, 0)
+
+/*
+ * Parameterized benchmarks. Argument 'arg' takes values lo, lo * mult, ...
+ * up to hi, and every value is registered as separate benchmark named
+ * 'name/arg'. Values can be overridden with -a.
+ *
+ * B63_BENCHMARK_RANGE(lookup, n, size, 1 << 10, 1 << 20, 4) {
+ *   ... 'size' is available here ...
+ * }
+ */
+#define B63_BENCHMARK_RANGE(bname, iters, arg, lo, hi, mult)                   \
+  void b63_run_args_##bname(b63_epoch *, uint64_t, int64_t, int64_t);          \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    b63_run_args_##bname(e, n, seed, e->benchmark->args[0]);                   \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = 0,                                                        \
+      .failed = 0,                                                             \
+      .args_size = 1,                                                          \
+      .ranges = {{lo, hi, mult}},                                              \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  void b63_run_args_##bname(b63_epoch *b63run, uint64_t iters,                 \
+                            int64_t b63_seed, int64_t arg)
+
+/* Cartesian product of two argument ranges, instances are named 'name/a/b' */
+#define B63_BENCHMARK_RANGE2(bname, iters, a, alo, ahi, amult, b, blo, bhi,    \
+                             bmult)                                            \
+  void b63_run_args_##bname(b63_epoch *, uint64_t, int64_t, int64_t,           \
+                            int64_t);                                          \
+  void b63_run_##bname(b63_epoch *e, uint64_t n, int64_t seed) {               \
+    b63_run_args_##bname(e, n, seed, e->benchmark->args[0],                    \
+                         e->benchmark->args[1]);                               \
+  }                                                                            \
+  static b63_benchmark b63_b_##bname = {                                       \
+      .name = #bname,                                                          \
+      .run = b63_run_##bname,                                                  \
+      .is_baseline = 0,                                                        \
+      .failed = 0,                                                             \
+      .args_size = 2,                                                          \
+      .ranges = {{alo, ahi, amult}, {blo, bhi, bmult}},                        \
+  };                                                                           \
+  B63_LIST_ADD(b63_benchmark, bname, &b63_b_##bname);                          \
+  void b63_run_args_##bname(b63_epoch *b63run, uint64_t iters,                 \
+                            int64_t b63_seed, int64_t a, int64_t b)
+
+/*
+ * Same body compiled for several targets, one benchmark per target, named
+ * name/target. Every variant reports its speedup over the first target,
+ * so it's usually "default"; variants are not the suite baseline:
+ *
+ * B63_BENCHMARK_ISA(saxpy, n, "default", "avx2", "avx512f") {
+ *   ...
+ * }
+ *
+ * Targets not supported by the host CPU are skipped. Up to
+ * B63_ISA_MAX_TARGETS targets; see isa.h.
+ */
+#define B63_BENCHMARK_ISA(bname, iters, ...)                                   \
+  static inline __attribute__((always_inline)) void b63_isa_body_##bname(      \
+      b63_epoch *, uint64_t, int64_t);                                         \
+  B63_ISA_VARIANTS(bname, __VA_ARGS__)                                         \
+  static inline __attribute__((always_inline)) void b63_isa_body_##bname(      \
+      b63_epoch *b63run, uint64_t iters, int64_t b63_seed)
+
 #endif
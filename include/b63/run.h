@@ -20,14 +20,27 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "benchmark.h"
+#include "cpu.h"
 #include "printer.h"
 #include "suite.h"
+#include "suspend.h"
+#include "calibration.h"
+#include "data.h"
+#include "exec.h"
+#include "latency.h"
+#include "phase.h"
 #include "utils/section_ptr_list.h"
+#include "utils/complexity.h"
+#include "utils/scaling.h"
 #include "utils/stats.h"
 #include "utils/timer.h"
 
+#include "counters/os.h"
 #include "counters/time.h"
 
 static void b63_epoch_run(b63_epoch *e, int64_t seed) {
@@ -39,76 +52,745 @@ static void b63_epoch_run(b63_epoch *e, int64_t seed) {
   const int64_t max_iterations_per_epoch = (1LL << 31LL);
   e->events = 0LL;
   e->iterations = 0LL;
+  e->seed = seed;
   e->suspension_done = 0;
   e->fail = 0;
+  e->histogram = NULL;
+  memset(e->phase_events, 0, sizeof(e->phase_events));
+  e->phase_names[0] = "other";
+  e->phases_size = 0;
+  e->phase = 0;
+  e->excluded_ns = 0;
+  e->bytes = 0;
+  e->items = 0;
+  e->thread_min = 0;
+  e->thread_sum = 0;
+  e->thread_max = 0;
+  if (b->latency) {
+    e->histogram = b->suite->histogram;
+    e->latency_countdown = 1;
+    b63_histogram_reset(e->histogram);
+  }
+  e->arrivals = NULL;
+  e->load_ticks = 0;
+  if (b->rate > 0) {
+    b63_load_schedule(b->suite->load_gaps, b->rate, b->suite->load_arrivals,
+                      seed);
+    e->arrivals = b->suite->load_gaps;
+  }
+
+  if (b->fixture != NULL) {
+    b63_fixture_acquire(b->fixture, seed, b->args_size > 0 ? b->args[0] : 0);
+  }
 
   int64_t started, done;
   /*
    * For each epoch run as many iterations as fit within the time budget
    */
   int64_t started_ms = b63_now_ms();
-  for (int64_t n = 1; e->iterations < max_iterations_per_epoch; n *= 2) {
+  b63_cache *cache = b->suite->cache;
+  /* with cold caches only the first iteration of a batch would be cold */
+  int8_t io_cold = b63_io_cold && b->fixture != NULL &&
+                   b->fixture->reset == b63_io_reset_any;
+  const int64_t growth = cache != NULL || io_cold ? 1 : 2;
+  int64_t n = b->suite->deterministic ? b->suite->iterations : 1;
+  for (; e->iterations < max_iterations_per_epoch; n *= growth) {
+
+    if (b->fixture != NULL && b->fixture->reset != NULL) {
+      b->fixture->reset(b->fixture->data, seed);
+    }
+
+    if (cache != NULL) {
+      int64_t evict_started = b63_monotonic_ns();
+      b63_cache_evict(cache, b->suite->cache_mode);
+      e->excluded_ns += b63_monotonic_ns() - evict_started;
+    }
 
     /* Here the 'measured' function is called */
-    started = counter->type->read(counter->impl);
-    b->run(e, n, seed);
-    done = counter->type->read(counter->impl);
+    if (b->measure != NULL) {
+      b->measure(e, n, seed, &started, &done);
+    } else {
+      started = counter->type->read(counter->impl);
+      e->phase_mark = started;
+      b->run(e, n, seed);
+      done = counter->type->read(counter->impl);
+    }
 
-    e->events += (done - started);
+    e->events += (done - started) - counter->calibration.batch;
+    e->phase_events[e->phase] += done - e->phase_mark;
+    e->phase_events[0] -= counter->calibration.batch;
+    e->phase = 0;
     e->iterations += n;
 
+    /* single batch of fixed size in deterministic mode */
+    if (b->suite->deterministic) {
+      break;
+    }
     /* ran out of time */
     if ((b63_now_ms() - started_ms) > timelimit_ms) {
       break;
     }
   }
-  b63_print_done(e);
+  if (b->latency) {
+    b63_latency_epoch_done(e, b->suite->latency_overhead);
+  }
 }
 
+/* seed for the next epoch; all benchmarks go through the same sequence */
+static int64_t b63_next_seed(int64_t seed) { return 134775853ULL * seed + 1; }
+
 /*
- * Runs benchmark b while measuring counter c
+ * Sequential stopping (--precision). Confidence interval is checked at
+ * 'looks' after B63_SEQUENTIAL_FIRST_LOOK, 2x, 4x, ... epochs and at
+ * max_epochs. Checking after every epoch and stopping at the first good
+ * looking interval would inflate the error rate, so the significance level
+ * at k-th look is 0.01 / 2^k. Sum over all looks stays within 0.01, same as
+ * the fixed epochs count mode.
  */
-static void b63_benchmark_run(b63_benchmark *b, b63_counter *c,
-                              b63_epoch *results) {
-  int64_t result_index = 0LL;
+#define B63_SEQUENTIAL_FIRST_LOOK 8
+
+static int8_t b63_sequential_is_look(b63_suite *suite, int64_t size) {
+  if (size == suite->max_epochs) {
+    return 1;
+  }
+  return size >= B63_SEQUENTIAL_FIRST_LOOK &&
+         size % B63_SEQUENTIAL_FIRST_LOOK == 0 &&
+         ((size / B63_SEQUENTIAL_FIRST_LOOK) &
+          (size / B63_SEQUENTIAL_FIRST_LOOK - 1)) == 0;
+}
+
+/* significance level of the interval after 'size' epochs */
+static double b63_sequential_alpha(b63_suite *suite, int64_t size) {
+  if (suite->precision <= 0.0) {
+    return 0.01;
+  }
+  double alpha = 0.01;
+  for (int64_t i = 1; i <= size; i++) {
+    if (b63_sequential_is_look(suite, i)) {
+      alpha /= 2.0;
+    }
+  }
+  return alpha;
+}
+
+static double b63_epoch_rate(b63_epoch *e) {
+  return 1.0 * e->events / e->iterations;
+}
+
+/*
+ * Whether benchmark b is compared with the suite baseline. Open-loop
+ * instances (--load) are not, as their counter values include waiting
+ * for scheduled arrivals.
+ */
+static int8_t b63_benchmark_compared(const b63_benchmark *b) {
+  return b->suite->baseline != NULL && !b->is_baseline && b->rate == 0;
+}
+
+/*
+ * Makes sure baseline has epoch i measured with counter c.
+ * Used when a benchmark needs more epochs than baseline did.
+ */
+static void b63_baseline_extend(b63_suite *suite, b63_counter *c, int64_t i) {
+  b63_benchmark *bl = suite->baseline;
+  while (bl->results_size <= i) {
+    b63_epoch *r = &(bl->results[bl->results_size]);
+    r->benchmark = bl;
+    r->counter = c;
+    b63_epoch_run(r, b63_next_seed(bl->results[bl->results_size - 1].seed));
+    bl->results_size++;
+  }
+}
+
+/*
+ * Runs up to 'size' epochs of benchmark b while measuring counter c.
+ * With --precision, epochs are paired with 'reference' epochs if it's not
+ * NULL, otherwise with the suite baseline, which is extended as needed.
+ * Returns number of epochs done, which is less than 'size' if benchmark
+ * failed or reached requested precision early.
+ */
+static int64_t b63_benchmark_run_epochs_vs(b63_benchmark *b, b63_counter *c,
+                                           b63_epoch *results,
+                                           b63_epoch *reference,
+                                           int64_t size) {
   b63_suite *suite = b->suite;
+  int64_t next_seed = suite->seed;
+  /* baseline results are not available to other processes */
+  int8_t paired =
+      reference == NULL && b63_benchmark_compared(b) && !suite->parallel;
   b63_stats tt;
   b63_stats_init(&tt);
 
-  int64_t next_seed = suite->seed;
+  for (int64_t e = 0; e < size; e++) {
+    b63_epoch *r = &(results[e]);
+    r->benchmark = b;
+    r->counter = c;
+    b63_epoch_run(r, next_seed);
+    if (r->fail) {
+      return e + 1;
+    }
+    next_seed = b63_next_seed(next_seed);
+
+    if (suite->precision <= 0.0) {
+      continue;
+    }
+    double baseline_rate = 0.0;
+    if (paired) {
+      b63_baseline_extend(suite, c, e);
+      baseline_rate = b63_epoch_rate(&(suite->baseline->results[e]));
+    } else if (reference != NULL) {
+      baseline_rate = b63_epoch_rate(&reference[e]);
+    }
+    b63_stats_add(b63_epoch_rate(r), baseline_rate, &tt);
+    if (b63_sequential_is_look(suite, e + 1)) {
+      tt.alpha = b63_sequential_alpha(suite, e + 1);
+      double reference_mean =
+          (paired || reference != NULL ? tt.sum_base : tt.sum_test) / tt.n;
+      if (100.0 * b63_stats_interval(&tt) <=
+          suite->precision * fabs(reference_mean)) {
+        return e + 1;
+      }
+    }
+  }
+  return size;
+}
+
+/* runs all epochs of benchmark b, paired with the suite baseline */
+static int64_t b63_benchmark_run_epochs(b63_benchmark *b, b63_counter *c,
+                                        b63_epoch *results) {
+  return b63_benchmark_run_epochs_vs(b, c, results, NULL,
+                                     b63_suite_max_epochs(b->suite));
+}
+
+/*
+ * Throughput rows of benchmark b, for bytes and items if set. Compared with
+ * baseline throughput if baseline sets the same amount, so that benchmarks
+ * processing different amounts per iteration can be compared as well.
+ */
+static void b63_benchmark_report_throughput(b63_benchmark *b, b63_counter *c,
+                                            b63_epoch *results, int64_t size) {
+  b63_benchmark *baseline = b->suite->baseline;
+  for (int k = 0; k < B63_THROUGHPUT_KINDS; k++) {
+    int8_t has = 0, compare = 0;
+    for (int64_t e = 0; e < size; e++) {
+      has |= b63_throughput_amount(&results[e], k) != 0;
+      compare |= b63_benchmark_compared(b) &&
+                 b63_throughput_amount(&(baseline->results[e]), k) != 0;
+    }
+    if (!has) {
+      continue;
+    }
+    b63_stats tt;
+    b63_stats_init(&tt);
+    tt.alpha = b63_sequential_alpha(b->suite, size);
+    for (int64_t e = 0; e < size; e++) {
+      b63_stats_add(b63_throughput(&results[e], k),
+                    compare ? b63_throughput(&(baseline->results[e]), k) : 0.0,
+                    &tt);
+    }
+    char name[64], unit[64];
+    snprintf(name, sizeof(name), "%s/%s", b->name, b63_throughput_names[k]);
+    b63_throughput_unit(c, k, unit, sizeof(unit));
+    if (compare) {
+      b63_print_comparison_dir(b, name, unit, &tt, 1);
+    } else {
+      b63_print_individual(b, name, unit, &tt);
+    }
+  }
+}
+
+/* events per iteration in phase 'name' of epoch e, 0 if there was none */
+static double b63_epoch_phase_rate(b63_epoch *e, const char *name) {
+  for (int8_t i = 0; i <= e->phases_size; i++) {
+    if (strcmp(e->phase_names[i], name) == 0) {
+      return 1.0 * e->phase_events[i] / e->iterations;
+    }
+  }
+  return 0.0;
+}
+
+/*
+ * Phase rows of benchmark b, including 'other'. Phases are matched by name
+ * between epochs and with baseline.
+ */
+static void b63_benchmark_report_phases(b63_benchmark *b, b63_counter *c,
+                                        b63_epoch *results, int64_t size) {
+  const char *names[B63_MAX_PHASES + 1];
+  int names_size = 0;
+  for (int64_t e = 0; e < size; e++) {
+    for (int8_t i = 1; i <= results[e].phases_size; i++) {
+      int found = 0;
+      for (int j = 0; j < names_size; j++) {
+        found |= strcmp(names[j], results[e].phase_names[i]) == 0;
+      }
+      if (!found && names_size < B63_MAX_PHASES) {
+        names[names_size++] = results[e].phase_names[i];
+      }
+    }
+  }
+  if (names_size == 0) {
+    return;
+  }
+  names[names_size++] = "other";
+
+  b63_benchmark *baseline = b->suite->baseline;
+  for (int i = 0; i < names_size; i++) {
+    /* compare if baseline has the same phase ('other' if any phases) */
+    int8_t compare = 0;
+    int8_t other = i == names_size - 1;
+    for (int64_t e = 0; b63_benchmark_compared(b) && e < size; e++) {
+      b63_epoch *r = &(baseline->results[e]);
+      for (int8_t j = 1; j <= r->phases_size; j++) {
+        compare |= other || strcmp(r->phase_names[j], names[i]) == 0;
+      }
+    }
+    b63_stats tt;
+    b63_stats_init(&tt);
+    tt.alpha = b63_sequential_alpha(b->suite, size);
+    for (int64_t e = 0; e < size; e++) {
+      b63_stats_add(
+          b63_epoch_phase_rate(&results[e], names[i]),
+          compare ? b63_epoch_phase_rate(&(baseline->results[e]), names[i])
+                  : 0.0,
+          &tt);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s/%s", b->name, names[i]);
+    if (compare) {
+      b63_print_comparison(b, name, c->name, &tt);
+    } else {
+      b63_print_individual(b, name, c->name, &tt);
+    }
+  }
+}
+
+/*
+ * Latency rows of benchmark b: every value (p50, ..., max) is compared
+ * with the same value of baseline epoch by epoch, if baseline is a latency
+ * benchmark too.
+ */
+static void b63_benchmark_report_latency(b63_benchmark *b, b63_epoch *results,
+                                         int64_t size) {
+  b63_benchmark *baseline = b->suite->baseline;
+  int8_t compare = b63_benchmark_compared(b) && baseline->latency;
+  for (int i = 0; i < B63_LATENCY_VALUES; i++) {
+    b63_stats tt;
+    b63_stats_init(&tt);
+    tt.alpha = b63_sequential_alpha(b->suite, size);
+    for (int64_t e = 0; e < size && !results[e].fail; e++) {
+      b63_stats_add(results[e].latency[i],
+                    compare ? baseline->results[e].latency[i] : 0.0, &tt);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s/%s", b->name, b63_latency_names[i]);
+    if (compare) {
+      b63_print_comparison(b, name, "latency_ns", &tt);
+    } else {
+      b63_print_individual(b, name, "latency_ns", &tt);
+    }
+  }
+}
+
+/*
+ * Open-loop latency benchmarks: load achieved, in operations per second.
+ * Keeps it and mean p99 for the knee, see b63_suite_report_load.
+ */
+static void b63_benchmark_report_load(b63_benchmark *b, b63_epoch *results,
+                                      int64_t size) {
+  b63_stats tt, p99;
+  b63_stats_init(&tt);
+  b63_stats_init(&p99);
+  tt.alpha = b63_sequential_alpha(b->suite, size);
+  double ns_per_tick = b63_latency_ns_per_tick();
+  for (int64_t e = 0; e < size && !results[e].fail; e++) {
+    if (results[e].load_ticks > 0) {
+      b63_stats_add(1e9 * results[e].iterations /
+                        (results[e].load_ticks * ns_per_tick),
+                    0.0, &tt);
+    }
+    b63_stats_add(results[e].latency[2], 0.0, &p99);
+  }
+  char name[64];
+  snprintf(name, sizeof(name), "%s/achieved", b->name);
+  b63_print_individual(b, name, "ops/s", &tt);
+  b->achieved = tt.n > 0 ? tt.sum_test / tt.n : 0.0;
+  b->p99 = p99.n > 0 ? p99.sum_test / p99.n : 0.0;
+}
+
+/*
+ * Multithreaded benchmarks: per-thread values per iteration (slowest,
+ * average and fastest thread) and imbalance, max / min.
+ */
+static void b63_benchmark_report_threads(b63_benchmark *b, b63_counter *c,
+                                         b63_epoch *results, int64_t size) {
+  static const char *names[] = {"thread_min", "thread_mean", "thread_max",
+                                "imbalance"};
+  for (int i = 0; i < 4; i++) {
+    b63_stats tt;
+    b63_stats_init(&tt);
+    tt.alpha = b63_sequential_alpha(b->suite, size);
+    for (int64_t e = 0; e < size && !results[e].fail; e++) {
+      b63_epoch *r = &results[e];
+      double v[] = {1.0 * r->thread_min / r->iterations,
+                    1.0 * r->thread_sum / b->threads / r->iterations,
+                    1.0 * r->thread_max / r->iterations,
+                    r->thread_min > 0 ? 1.0 * r->thread_max / r->thread_min
+                                      : 0.0};
+      b63_stats_add(v[i], 0.0, &tt);
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "%s/%s", b->name, names[i]);
+    b63_print_individual(b, name, i < 3 ? c->name : "ratio", &tt);
+  }
+}
+
+/* FNV-1a, used for the hash of results in deterministic mode */
+static uint64_t b63_hash_update(uint64_t hash, const void *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ ((const uint8_t *)data)[i]) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+static void b63_hash_epoch(b63_suite *suite, b63_epoch *r) {
+  suite->hash = b63_hash_update(suite->hash, r->benchmark->name,
+                                strlen(r->benchmark->name) + 1);
+  suite->hash =
+      b63_hash_update(suite->hash, r->counter->name, strlen(r->counter->name) + 1);
+  suite->hash = b63_hash_update(suite->hash, &r->iterations, sizeof(int64_t));
+  suite->hash = b63_hash_update(suite->hash, &r->events, sizeof(int64_t));
+}
+
+/*
+ * Prints results of 'size' epochs of benchmark b, measured with counter c,
+ * comparing to baseline if there is one.
+ */
+static void b63_benchmark_report(b63_benchmark *b, b63_counter *c,
+                                 b63_epoch *results, int64_t size) {
+  b63_suite *suite = b->suite;
+  b63_stats tt;
+  b63_stats_init(&tt);
+  tt.alpha = b63_sequential_alpha(suite, size);
+
   b63_epoch *baseline_result = NULL;
-  if (suite->baseline != NULL && b->is_baseline == 0) {
+  if (b63_benchmark_compared(b)) {
     baseline_result = suite->baseline->results;
+    /* baseline might have stopped earlier in parallel mode */
+    if (size > suite->baseline->results_size) {
+      size = suite->baseline->results_size;
+    }
   }
 
-  for (int64_t e = 0; e < suite->epochs; e++) {
-    b63_epoch *r = &(results[result_index++]);
-    r->benchmark = b;
-    r->counter = c;
-    b63_epoch_run(r, next_seed);
+  for (int64_t e = 0; e < size; e++) {
+    b63_epoch *r = &(results[e]);
+    b63_print_done(r);
+    b63_hash_epoch(suite, r);
     if (r->fail) {
       b->failed = 1;
       break;
     }
-    next_seed = 134775853ULL * next_seed + 1;
 
     double baseline_rate = 0.0;
     if (baseline_result != NULL) {
-      baseline_rate =
-          1.0 * baseline_result->events / baseline_result->iterations;
+      baseline_rate = b63_epoch_rate(baseline_result);
       baseline_result++;
     }
-    b63_stats_add(1.0 * r->events / r->iterations, baseline_rate, &tt);
+    b63_stats_add(b63_epoch_rate(r), baseline_rate, &tt);
   }
+  b->mean = tt.sum_test / tt.n;
   if (baseline_result != NULL) {
-    b63_print_comparison(b, c->name, &tt);
+    b63_print_comparison(b, b->name, c->name, &tt);
   } else {
-    b63_print_individual(b, c->name, &tt);
+    b63_print_individual(b, b->name, c->name, &tt);
+  }
+  if (suite->cache != NULL) {
+    int64_t excluded_ns = 0, batches = 0;
+    for (int64_t e = 0; e < size; e++) {
+      excluded_ns += results[e].excluded_ns;
+      batches += results[e].iterations;
+    }
+    b63_print_excluded(b, excluded_ns, batches);
+  }
+  if (!b->failed) {
+    b63_benchmark_report_throughput(b, c, results, size);
+    b63_benchmark_report_phases(b, c, results, size);
+    if (b->threads > 0) {
+      b63_benchmark_report_threads(b, c, results, size);
+    }
+  }
+  if (b->latency && c == suite->counter_list.data && !b->failed) {
+    b63_benchmark_report_latency(b, results, size);
+    if (b->rate > 0) {
+      b63_benchmark_report_load(b, results, size);
+    }
   }
 }
 
-static void b63_suite_run(b63_suite *suite) {
+/*
+ * Measures benchmark b again while aggressors are running, as name/noisy,
+ * and reports degradation relative to the quiet epochs.
+ */
+static void b63_benchmark_run_noisy(b63_benchmark *b, b63_counter *c,
+                                    b63_epoch *quiet, int64_t quiet_size) {
+  b63_suite *suite = b->suite;
+  b63_epoch *results =
+      (b63_epoch *)malloc(b63_suite_max_epochs(suite) * sizeof(b63_epoch));
+  size_t name_size = strlen(b->name) + 8;
+  char *name = (char *)malloc(name_size);
+  /* const members, so the struct is copied as a whole */
+  b63_benchmark *noisy = (b63_benchmark *)malloc(sizeof(b63_benchmark));
+  if (results == NULL || name == NULL || noisy == NULL) {
+    fprintf(stderr, "memory allocation failed for noisy run\n");
+    exit(EXIT_FAILURE);
+  }
+  snprintf(name, name_size, "%s/noisy", b->name);
+  memcpy((void *)noisy, b, sizeof(b63_benchmark));
+  noisy->name = name;
+
+  /*
+   * paired with quiet epochs only: the baseline measured next to
+   * aggressors would end up in quiet comparisons
+   */
+  b63_noise_start(suite->noise);
+  int64_t size =
+      b63_benchmark_run_epochs_vs(noisy, c, results, quiet, quiet_size);
+  b63_noise_stop(suite->noise);
+
+  b63_stats tt;
+  b63_stats_init(&tt);
+  tt.alpha = b63_sequential_alpha(suite, size);
+  for (int64_t e = 0; e < size; e++) {
+    b63_epoch *r = &(results[e]);
+    b63_print_done(r);
+    b63_hash_epoch(suite, r);
+    if (r->fail) {
+      noisy->failed = 1;
+      break;
+    }
+    b63_stats_add(b63_epoch_rate(r), b63_epoch_rate(&quiet[e]), &tt);
+  }
+  b63_print_comparison(noisy, noisy->name, c->name, &tt);
+  free(noisy);
+  free(name);
+  free(results);
+}
+
+/*
+ * Reports 'size' epochs of benchmark b measured with counter c and repeats
+ * them under noise if requested.
+ */
+static void b63_benchmark_finish(b63_benchmark *b, b63_counter *c,
+                                 b63_epoch *results, int64_t size) {
+  b63_benchmark_report(b, c, results, size);
+  if (b->suite->noise != NULL && !b->failed) {
+    b63_benchmark_run_noisy(b, c, results, size);
+  }
+}
+
+/*
+ * Runs benchmark b while measuring counter c
+ */
+static void b63_benchmark_run(b63_benchmark *b, b63_counter *c,
+                              b63_epoch *results) {
+  int64_t size = b63_benchmark_run_epochs(b, c, results);
+  if (b->is_baseline) {
+    b->results_size = size;
+  }
+  b63_benchmark_finish(b, c, results, size);
+}
+
+/*
+ * Values of parameterized benchmark argument: either from the range in the
+ * code or from '-a' override for that argument. Returns number of values
+ * written to out, which should be NULL to only count them.
+ */
+static size_t b63_range_values(b63_range *range, const char *override,
+                               int64_t *out) {
+  size_t size = 0;
+  if (override != NULL && *override != '\0' && *override != '/') {
+    char *e;
+    for (const char *p = override; *p != '\0' && *p != '/'; p = e) {
+      int64_t v = strtoll(p, &e, 10);
+      if (e == p) {
+        fprintf(stderr, "unable to parse arguments: %s\n", override);
+        exit(EXIT_FAILURE);
+      }
+      if (out != NULL) {
+        out[size] = v;
+      }
+      size++;
+      if (*e == ',') {
+        e++;
+      }
+    }
+    return size;
+  }
+  int64_t v = range->lo;
+  for (; v < range->hi; v = range->mult > 1 ? v * range->mult : range->hi) {
+    if (out != NULL) {
+      out[size] = v;
+    }
+    size++;
+  }
+  if (out != NULL) {
+    out[size] = range->hi;
+  }
+  return size + 1;
+}
+
+/* creates benchmark with specific args out of the family */
+static b63_benchmark *b63_benchmark_instance(b63_benchmark *family,
+                                             const int64_t *args) {
+  b63_benchmark *b = (b63_benchmark *)malloc(sizeof(b63_benchmark));
+  size_t name_size = strlen(family->name) + 24 * family->args_size + 1;
+  char *name = (char *)malloc(name_size);
+  if (b == NULL || name == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy((void *)b, family, sizeof(b63_benchmark));
+  size_t len = snprintf(name, name_size, "%s", family->name);
+  for (int8_t i = 0; i < family->args_size; i++) {
+    b->args[i] = args[i];
+    len += snprintf(name + len, name_size - len, "/%" PRId64, args[i]);
+  }
+  b->name = name;
+  b->family = family;
+  return b;
+}
+
+/* copy of the benchmark named name/suffix, as its instance */
+static b63_benchmark *b63_benchmark_variant(b63_benchmark *family,
+                                            const char *suffix) {
+  b63_benchmark *b = (b63_benchmark *)malloc(sizeof(b63_benchmark));
+  size_t name_size = strlen(family->name) + strlen(suffix) + 2;
+  char *name = (char *)malloc(name_size);
+  if (b == NULL || name == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark\n");
+    exit(EXIT_FAILURE);
+  }
+  memcpy((void *)b, family, sizeof(b63_benchmark));
+  snprintf(name, name_size, "%s/%s", family->name, suffix);
+  b->name = name;
+  b->family = family;
+  return b;
+}
+
+/* copy of multithreaded benchmark running with other thread count */
+static b63_benchmark *b63_benchmark_scale_instance(b63_benchmark *family,
+                                                   int threads) {
+  char suffix[16];
+  snprintf(suffix, sizeof(suffix), "t%d", threads);
+  b63_benchmark *b = b63_benchmark_variant(family, suffix);
+  b->threads = threads;
+  return b;
+}
+
+/* copy of latency benchmark running in open loop at rate ops/s */
+static b63_benchmark *b63_benchmark_load_instance(b63_benchmark *family,
+                                                  int64_t rate) {
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), "%" PRId64 "ops", rate);
+  b63_benchmark *b = b63_benchmark_variant(family, suffix);
+  b->rate = rate;
+  return b;
+}
+
+/* with --scale, multithreaded benchmarks run with each of thread counts */
+static int b63_benchmark_scaled(const b63_benchmark *b) {
+  return b->threads > 0 && !b->is_baseline && b->args_size == 0 &&
+         b->suite->scale_size > 0;
+}
+
+/* with --load, latency benchmarks run in open loop at each of the rates */
+static int b63_benchmark_loaded(const b63_benchmark *b) {
+  return b->latency && b->depth == 0 && !b->is_baseline &&
+         b->args_size == 0 && b->suite->load_size > 0;
+}
+
+/*
+ * All benchmarks registered in the section list and at runtime.
+ * Caller frees the array.
+ */
+static b63_benchmark **b63_registered_benchmarks(size_t *size) {
+  b63_benchmark **res = (b63_benchmark **)malloc(
+      (B63_LIST_SIZE(b63_benchmark) + b63_runtime_benchmarks_size) *
+      sizeof(b63_benchmark *));
+  if (res == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark list\n");
+    exit(EXIT_FAILURE);
+  }
+  *size = 0;
   B63_LIST_FOR_EACH(b63_benchmark, b) {
+    if (*b == NULL) {
+      continue;
+    }
+    if ((*b)->isa != NULL && !b63_isa_supported((*b)->isa)) {
+      fprintf(stderr, "skipping %s: target not supported by cpu\n",
+              (*b)->name);
+      continue;
+    }
+    res[(*size)++] = *b;
+  }
+  /*
+   * Section order is up to the compiler and linker. Variants of one
+   * B63_BENCHMARK_ISA are next to each other, and are put in declaration
+   * order, so that the reference target is reported first.
+   */
+  for (size_t i = 1; i < *size; i++) {
+    for (size_t j = i; j > 0 && res[j]->isa_default != NULL &&
+                       res[j - 1]->isa_default == res[j]->isa_default &&
+                       res[j - 1]->isa_index > res[j]->isa_index;
+         j--) {
+      b63_benchmark *t = res[j];
+      res[j] = res[j - 1];
+      res[j - 1] = t;
+    }
+  }
+  for (size_t i = 0; i < b63_runtime_benchmarks_size; i++) {
+    res[(*size)++] = b63_runtime_benchmarks[i];
+  }
+  return res;
+}
+
+/* with --exec, only external commands are run */
+static void b63_suite_collect_exec(b63_suite *suite) {
+  size_t size = suite->exec_size + (suite->exec_baseline != NULL);
+  suite->benchmarks = (b63_benchmark **)malloc(size * sizeof(b63_benchmark *));
+  if (suite->benchmarks == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark list\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t i = 0;
+  if (suite->exec_baseline != NULL) {
+    suite->baseline = b63_exec_benchmark(suite, suite->exec_baseline, 1);
+    suite->benchmarks[i++] = suite->baseline;
+  }
+  for (size_t c = 0; c < suite->exec_size; c++) {
+    suite->benchmarks[i++] = b63_exec_benchmark(suite, suite->exec[c], 0);
+  }
+  suite->benchmarks_size = i;
+}
+
+/*
+ * Builds the list of all benchmarks to run, baseline first, as others are
+ * compared to it. Parameterized benchmarks are expanded into instances.
+ */
+static void b63_suite_collect(b63_suite *suite) {
+  const char *overrides[B63_MAX_ARGS] = {suite->args, NULL};
+  if (suite->args != NULL && strchr(suite->args, '/') != NULL) {
+    overrides[1] = strchr(suite->args, '/') + 1;
+  }
+
+  if (suite->exec_size > 0 || suite->exec_baseline != NULL) {
+    b63_suite_collect_exec(suite);
+    return;
+  }
+
+  b63_fixture_attach_hooks();
+  size_t registered_size = 0;
+  b63_benchmark **registered = b63_registered_benchmarks(&registered_size);
+  size_t size = 0;
+  for (b63_benchmark **b = registered; b < registered + registered_size; b++) {
     (*b)->suite = suite;
     /* set baseline */
     if ((*b)->is_baseline) {
@@ -118,36 +800,717 @@ static void b63_suite_run(b63_suite *suite) {
       }
       suite->baseline = *b;
     }
+    size_t instances = 1;
+    if (b63_benchmark_scaled(*b)) {
+      instances = suite->scale_size;
+    }
+    if (b63_benchmark_loaded(*b)) {
+      instances = suite->load_size;
+    }
+    for (int8_t i = 0; i < (*b)->args_size; i++) {
+      b63_range *r = &(*b)->ranges[i];
+      if (r->lo <= 0 || r->hi < r->lo || r->mult < 1) {
+        fprintf(stderr,
+                "%s: argument range needs 0 < lo <= hi and mult >= 1, "
+                "got lo=%" PRId64 " hi=%" PRId64 " mult=%" PRId64 "\n",
+                (*b)->name, r->lo, r->hi, r->mult);
+        exit(EXIT_FAILURE);
+      }
+      instances *= b63_range_values(r, overrides[i], NULL);
+    }
+    size += instances;
   }
 
-  b63_epoch *results = (b63_epoch *)malloc(suite->epochs * sizeof(b63_epoch));
-  b63_epoch *baseline_results = NULL;
+  suite->benchmarks = (b63_benchmark **)malloc(size * sizeof(b63_benchmark *));
+  if (suite->benchmarks == NULL) {
+    fprintf(stderr, "memory allocation failed for benchmark list\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t i = 0;
   if (suite->baseline != NULL) {
-    baseline_results = (b63_epoch *)malloc(suite->epochs * sizeof(b63_epoch));
-    suite->baseline->results = baseline_results;
+    suite->benchmarks[i++] = suite->baseline;
+  }
+  for (b63_benchmark **b = registered; b < registered + registered_size; b++) {
+    if ((*b)->is_baseline) {
+      continue;
+    }
+    if (b63_benchmark_scaled(*b)) {
+      for (size_t t = 0; t < suite->scale_size; t++) {
+        suite->benchmarks[i++] =
+            b63_benchmark_scale_instance(*b, suite->scale[t]);
+      }
+      continue;
+    }
+    if (b63_benchmark_loaded(*b)) {
+      for (size_t r = 0; r < suite->load_size; r++) {
+        suite->benchmarks[i++] = b63_benchmark_load_instance(*b, suite->load[r]);
+      }
+      continue;
+    }
+    if ((*b)->args_size == 0) {
+      suite->benchmarks[i++] = *b;
+      continue;
+    }
+    int64_t *values[B63_MAX_ARGS];
+    size_t values_size[B63_MAX_ARGS] = {1, 1};
+    for (int8_t a = 0; a < (*b)->args_size; a++) {
+      values_size[a] = b63_range_values(&(*b)->ranges[a], overrides[a], NULL);
+      values[a] = (int64_t *)malloc(values_size[a] * sizeof(int64_t));
+      if (values[a] == NULL) {
+        fprintf(stderr, "memory allocation failed for benchmark list\n");
+        exit(EXIT_FAILURE);
+      }
+      b63_range_values(&(*b)->ranges[a], overrides[a], values[a]);
+    }
+    for (size_t v0 = 0; v0 < values_size[0]; v0++) {
+      for (size_t v1 = 0; v1 < values_size[1]; v1++) {
+        int64_t args[B63_MAX_ARGS] = {values[0][v0],
+                                      (*b)->args_size > 1 ? values[1][v1] : 0};
+        suite->benchmarks[i++] = b63_benchmark_instance(*b, args);
+      }
+    }
+    for (int8_t a = 0; a < (*b)->args_size; a++) {
+      free(values[a]);
+    }
+  }
+  free(registered);
+  suite->benchmarks_size = i;
+}
+
+/* destroys fixtures which were built */
+static void b63_suite_release_fixtures(b63_suite *suite) {
+  for (size_t i = 0; i < suite->benchmarks_size; i++) {
+    if (suite->benchmarks[i]->fixture != NULL) {
+      b63_fixture_release(suite->benchmarks[i]->fixture);
+    }
+  }
+}
+
+/*
+ * Frees benchmark list, including instances of parameterized benchmarks,
+ * and fixtures.
+ */
+static void b63_suite_cleanup_benchmarks(b63_suite *suite) {
+  b63_suite_release_fixtures(suite);
+  for (size_t i = 0; i < suite->benchmarks_size; i++) {
+    if (suite->benchmarks[i]->family != NULL) {
+      free((char *)suite->benchmarks[i]->name);
+      free(suite->benchmarks[i]);
+    } else if (suite->benchmarks[i]->command != NULL) {
+      /* name is the command from argv */
+      free(suite->benchmarks[i]);
+    }
+  }
+  free(suite->benchmarks);
+  suite->benchmarks = NULL;
+  suite->benchmarks_size = 0;
+}
+
+/*
+ * Throughput knee of open-loop benchmark over offered loads: the highest
+ * load which is still served (achieved >= 95% of offered) with p99 within
+ * 2x of p99 at the lightest load.
+ */
+static void b63_suite_report_load(b63_suite *suite, size_t from, size_t size) {
+  b63_benchmark **b = suite->benchmarks + from;
+  size_t lightest = 0;
+  for (size_t i = 1; i < size; i++) {
+    if (b[i]->rate < b[lightest]->rate) {
+      lightest = i;
+    }
+  }
+  b63_benchmark *knee = NULL, *heaviest = b[lightest];
+  for (size_t i = 0; i < size; i++) {
+    if (b[i]->rate > heaviest->rate) {
+      heaviest = b[i];
+    }
+    if (b[i]->achieved >= 0.95 * b[i]->rate &&
+        b[i]->p99 <= 2.0 * b[lightest]->p99 &&
+        (knee == NULL || b[i]->rate > knee->rate)) {
+      knee = b[i];
+    }
+  }
+  b63_print_knee(b[0]->family, knee, heaviest);
+}
+
+/*
+ * Speedup of every thread count relative to the first one and fits of
+ * Amdahl and USL models. Mean rate is per iteration with every thread
+ * running the same number of iterations, so throughput is threads / mean.
+ */
+static void b63_suite_report_scaling(b63_suite *suite, b63_counter *c,
+                                     size_t from, size_t size) {
+  double n[64], speedup[64];
+  b63_benchmark **b = suite->benchmarks + from;
+  if (size > sizeof(n) / sizeof(n[0])) {
+    size = sizeof(n) / sizeof(n[0]);
+  }
+  if (size < 2 || !(b[0]->mean > 0.0)) {
+    return;
+  }
+  for (size_t i = 0; i < size; i++) {
+    if (!(b[i]->mean > 0.0)) {
+      return;
+    }
+  }
+  /*
+   * Speedup only makes sense for time. Other counters are per-thread
+   * events per iteration, and their growth with thread count shows which
+   * resource saturates first.
+   */
+  if (!b63_throughput_is_time(c)) {
+    for (size_t i = 1; i < size; i++) {
+      b63_print_scaling_ratio(b[i], c->name, b[i]->mean / b[0]->mean,
+                              b[0]->threads);
+    }
+    return;
+  }
+  for (size_t i = 0; i < size; i++) {
+    n[i] = (double)b[i]->threads / b[0]->threads;
+    speedup[i] = n[i] * b[0]->mean / b[i]->mean;
+    b63_print_speedup(b[i], c->name, speedup[i], n[i]);
+  }
+  b63_scaling s;
+  if (b63_scaling_fit(n, speedup, size, &s)) {
+    b63_print_scaling(b[0]->family, c->name, &s, b[0]->threads);
+  }
+}
+
+/*
+ * Speedup of every ISA variant relative to the first target of its
+ * B63_BENCHMARK_ISA, from mean rates of the last report. Variants are not
+ * paired with the suite baseline, so several ISA benchmarks and a regular
+ * baseline can be defined in one suite.
+ */
+static void b63_suite_report_isa(b63_suite *suite, b63_counter *c) {
+  for (size_t i = 0; i < suite->benchmarks_size; i++) {
+    b63_benchmark *b = suite->benchmarks[i];
+    b63_benchmark *d = b->isa_default;
+    if (d == NULL || d == b || b->failed || d->failed || !(b->mean > 0.0) ||
+        !(d->mean > 0.0)) {
+      continue;
+    }
+    b63_print_isa_speedup(b, c->name, d->mean / b->mean);
+  }
+}
+
+/*
+ * Fits complexity for every single-argument family, using mean rates
+ * from the last report. For input pools, reports sensitivity to the pool
+ * size instead, for thread counts from --scale - scalability, and for
+ * offered loads from --load - the throughput knee.
+ */
+static void b63_suite_report_complexity(b63_suite *suite, b63_counter *c) {
+  double n[64], y[64];
+  b63_suite_report_isa(suite, c);
+  for (size_t i = 0; i < suite->benchmarks_size;) {
+    b63_benchmark *family = suite->benchmarks[i]->family;
+    size_t size = 0;
+    int8_t failed = 0;
+    for (; i < suite->benchmarks_size && family != NULL &&
+           suite->benchmarks[i]->family == family;
+         i++) {
+      failed |= suite->benchmarks[i]->failed;
+      if (size < sizeof(n) / sizeof(n[0])) {
+        n[size] = suite->benchmarks[i]->args[0];
+        y[size] = suite->benchmarks[i]->mean;
+        size++;
+      }
+    }
+    if (family == NULL) {
+      i++;
+      continue;
+    }
+    if (b63_benchmark_scaled(family) && !failed) {
+      b63_suite_report_scaling(suite, c, i - size, size);
+      continue;
+    }
+    if (b63_benchmark_loaded(family)) {
+      if (!failed && c == suite->counter_list.data) {
+        b63_suite_report_load(suite, i - size, size);
+      }
+      continue;
+    }
+    if (family->args_size != 1 || failed) {
+      continue;
+    }
+    if (family->fixture != NULL && family->fixture->pool) {
+      b63_print_pool_sensitivity(family, c->name, n, y, size);
+      continue;
+    }
+    if (size < 3) {
+      continue;
+    }
+    double coef = 0.0, rms = 0.0;
+    int model = b63_complexity_fit(n, y, size, &coef, &rms);
+    if (model >= 0) {
+      b63_print_complexity(family, c->name, model, coef, rms);
+    }
+  }
+}
+
+/*
+ * Parallel mode: each benchmark runs in a forked process pinned to its own
+ * cpu, up to one process per cpu at a time. Results are written to shared
+ * memory and reported by the parent in the usual order once all are done.
+ * Counters are constructed again in every child, as some of them
+ * (lpe, for example) only count events of the thread which created them.
+ */
+static void b63_parallel_child(b63_benchmark *b, b63_counter *counter,
+                               int cpu, b63_epoch *results, int64_t *size) {
+  b63_counter local;
+  memset(&local, 0, sizeof(b63_counter));
+  /* parent marks the benchmark failed */
+  if (!b63_cpu_pin(cpu) && b->suite->cpus_strict) {
+    _exit(EXIT_FAILURE);
+  }
+  if (!b63_counter_init(&local, counter->name,
+                        counter->name + strlen(counter->name))) {
+    _exit(EXIT_FAILURE);
+  }
+  if (local.type->activate != NULL) {
+    local.type->activate(local.impl);
+  }
+  local.calibration = counter->calibration;
+  *size = b63_benchmark_run_epochs(b, &local, results);
+  b63_counter_cleanup(&local);
+  b63_suite_release_fixtures(b->suite);
+  _exit(EXIT_SUCCESS);
+}
+
+static void b63_suite_run_parallel(b63_suite *suite, b63_benchmark **benchmarks,
+                                   size_t benchmarks_size, b63_counter *counter,
+                                   b63_epoch *results, int64_t *sizes) {
+  pid_t *pids = (pid_t *)calloc(suite->cpus_size, sizeof(pid_t));
+  /* index of the benchmark running on every cpu */
+  size_t *running_index = (size_t *)calloc(suite->cpus_size, sizeof(size_t));
+  if (pids == NULL || running_index == NULL) {
+    fprintf(stderr, "memory allocation failed for parallel run\n");
+    exit(EXIT_FAILURE);
+  }
+  size_t next = 0, running = 0;
+  while (next < benchmarks_size || running > 0) {
+    /* start as many benchmarks as there are free cpus */
+    for (size_t i = 0; i < suite->cpus_size && next < benchmarks_size; i++) {
+      if (pids[i] != 0) {
+        continue;
+      }
+      sizes[next] = 0;
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid == -1) {
+        fprintf(stderr, "fork failed\n");
+        exit(EXIT_FAILURE);
+      }
+      if (pid == 0) {
+        b63_parallel_child(benchmarks[next], counter, suite->cpus[i],
+                           results + next * b63_suite_max_epochs(suite),
+                           &sizes[next]);
+      }
+      pids[i] = pid;
+      running_index[i] = next;
+      running++;
+      next++;
+    }
+    int status = 0;
+    pid_t done = wait(&status);
+    for (size_t i = 0; i < suite->cpus_size; i++) {
+      if (pids[i] != done) {
+        continue;
+      }
+      pids[i] = 0;
+      running--;
+      if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS) {
+        continue;
+      }
+      b63_benchmark *b = benchmarks[running_index[i]];
+      if (WIFSIGNALED(status)) {
+        fprintf(stderr, "%s: process killed by signal %d\n", b->name,
+                WTERMSIG(status));
+      } else {
+        fprintf(stderr, "%s: process exited with status %d\n", b->name,
+                WEXITSTATUS(status));
+      }
+      b->failed = 1;
+      sizes[running_index[i]] = 0;
+    }
+  }
+  free(pids);
+  free(running_index);
+
+  /* pointers were set in the child's copy of the counter */
+  for (size_t b = 0; b < benchmarks_size; b++) {
+    b63_epoch *r = results + b * b63_suite_max_epochs(suite);
+    for (int64_t e = 0; e < sizes[b]; e++) {
+      r[e].benchmark = benchmarks[b];
+      r[e].counter = counter;
+    }
+  }
+}
+
+/*
+ * Budget mode (--budget): instead of fixed number of epochs per
+ * benchmark/counter pair, the whole suite gets a time budget. After a few
+ * pilot epochs of every pair, next epoch always goes to the pair which is
+ * furthest from a conclusive result, until the budget is spent:
+ *  - for comparisons with baseline, score is interval half-width relative to
+ *    the observed difference; > 1 means interval still straddles zero;
+ *  - without baseline, score is interval half-width relative to the mean.
+ * Baseline epochs are added as needed to keep the pairs.
+ * Note that intervals are not corrected for this data-dependent allocation.
+ */
+#define B63_BUDGET_PILOT_EPOCHS 5
+
+/* all epochs measured so far for a benchmark/counter pair */
+typedef struct b63_series {
+  b63_epoch *epochs;
+  int64_t size, capacity;
+} b63_series;
+
+static void b63_series_reserve(b63_series *s, int64_t size) {
+  if (s->capacity >= size) {
+    return;
+  }
+  s->capacity = s->capacity == 0 ? 2 * B63_BUDGET_PILOT_EPOCHS : s->capacity;
+  while (s->capacity < size) {
+    s->capacity *= 2;
+  }
+  s->epochs = (b63_epoch *)realloc(s->epochs, s->capacity * sizeof(b63_epoch));
+  if (s->epochs == NULL) {
+    fprintf(stderr, "memory allocation failed for results\n");
+    exit(EXIT_FAILURE);
+  }
+}
+
+/* runs one more epoch of benchmark b, and of the baseline if needed */
+static void b63_budget_epoch(b63_benchmark *b, b63_counter *c, b63_series *s,
+                             b63_series *baseline) {
+  b63_suite *suite = b->suite;
+  b63_series_reserve(s, s->size + 1);
+  if (baseline != NULL) {
+    b63_series_reserve(baseline, s->size + 1);
+    suite->baseline->results = baseline->epochs;
+    suite->baseline->results_size = baseline->size;
+    if (baseline->size > 0) {
+      b63_baseline_extend(suite, c, s->size);
+      baseline->size = suite->baseline->results_size;
+    }
+  }
+  b63_epoch *r = &(s->epochs[s->size]);
+  r->benchmark = b;
+  r->counter = c;
+  b63_epoch_run(r, s->size == 0 ? suite->seed
+                                : b63_next_seed(s->epochs[s->size - 1].seed));
+  if (r->fail) {
+    b->failed = 1;
+  }
+  s->size++;
+}
+
+/*
+ * How far the pair is from conclusive result, per epoch already spent on it.
+ * Differences below 0.1% are treated as 0.1%, and the per-epoch weighting
+ * makes sure a pair which can never become conclusive (for example, A/A
+ * test) does not take the whole budget.
+ */
+static double b63_budget_score(b63_series *s, b63_series *baseline) {
+  b63_stats tt;
+  b63_stats_init(&tt);
+  for (int64_t e = 0; e < s->size; e++) {
+    b63_stats_add(b63_epoch_rate(&(s->epochs[e])),
+                  baseline == NULL ? 0.0 : b63_epoch_rate(&(baseline->epochs[e])),
+                  &tt);
+  }
+  double reference = (baseline == NULL ? tt.sum_test : tt.sum_base) / tt.n;
+  double d = fabs(b63_stats_diff(&tt));
+  if (d < 0.001 * fabs(reference)) {
+    d = 0.001 * fabs(reference);
+  }
+  double interval = b63_stats_interval(&tt);
+  if (interval == 0.0) {
+    return 0.0;
+  }
+  return d > 0.0 ? interval / d / s->size : INFINITY;
+}
+
+static void b63_suite_run_budget(b63_suite *suite, b63_benchmark **benchmarks,
+                                 size_t benchmarks_size) {
+  b63_counter_list *counters = &suite->counter_list;
+  b63_series *series = (b63_series *)calloc(counters->size * benchmarks_size,
+                                            sizeof(b63_series));
+  if (series == NULL) {
+    fprintf(stderr, "memory allocation failed for results\n");
+    exit(EXIT_FAILURE);
+  }
+  int64_t started_ms = b63_now_ms();
+  b63_counter *active = NULL;
+  int8_t compared = 0;
+  for (size_t b = 0; b < benchmarks_size; b++) {
+    compared |= b63_benchmark_compared(benchmarks[b]);
   }
 
   B63_FOR_EACH_COUNTER(suite->counter_list, counter) {
     if (counter->type->activate != NULL) {
       counter->type->activate(counter->impl);
     }
-    if (suite->baseline != NULL) {
-      b63_benchmark_run(suite->baseline, counter, baseline_results);
+    if (suite->calibrate) {
+      b63_calibrate(counter);
+      b63_print_calibration(suite, counter);
     }
-    B63_LIST_FOR_EACH(b63_benchmark, b) {
-      if ((*b)->is_baseline) {
+    active = counter;
+  }
+
+  /* first pilot epochs for everything, then one epoch at a time */
+  for (int64_t epoch = 0;; epoch++) {
+    b63_series *next = NULL;
+    size_t next_index = 0;
+    double next_score = -1.0;
+    for (size_t i = 0; i < counters->size * benchmarks_size; i++) {
+      b63_benchmark *b = benchmarks[i % benchmarks_size];
+      /*
+       * baseline epochs are added when other benchmarks need them, and are
+       * printed only once, with the final report
+       */
+      if (b->failed || (b->is_baseline && compared)) {
         continue;
       }
-      b63_benchmark_run(*b, counter, results);
+      b63_series *baseline = NULL;
+      if (b63_benchmark_compared(b)) {
+        baseline = &series[i - i % benchmarks_size];
+      }
+      double score = series[i].size < B63_BUDGET_PILOT_EPOCHS
+                         ? INFINITY
+                         : b63_budget_score(&series[i], baseline);
+      if (score > next_score) {
+        next = &series[i];
+        next_index = i;
+        next_score = score;
+      }
+      if (series[i].size < B63_BUDGET_PILOT_EPOCHS) {
+        break;
+      }
+    }
+    if (next == NULL) {
+      break;
+    }
+    int8_t pilot = next->size < B63_BUDGET_PILOT_EPOCHS;
+    if (!pilot && b63_now_ms() - started_ms > 1000LL * suite->budget_s) {
+      break;
+    }
+
+    b63_counter *c = &counters->data[next_index / benchmarks_size];
+    if (c != active && c->type->activate != NULL) {
+      c->type->activate(c->impl);
+    }
+    active = c;
+    b63_benchmark *b = benchmarks[next_index % benchmarks_size];
+    b63_series *baseline = NULL;
+    if (b63_benchmark_compared(b)) {
+      baseline = &series[next_index - next_index % benchmarks_size];
+      if (baseline->size == 0) {
+        b63_budget_epoch(suite->baseline, c, baseline, NULL);
+      }
     }
+    b63_budget_epoch(b, c, next, baseline);
   }
 
-  free(results);
+  for (size_t ci = 0; ci < counters->size; ci++) {
+    b63_series *s = series + ci * benchmarks_size;
+    if (suite->baseline != NULL) {
+      suite->baseline->results = s[0].epochs;
+      suite->baseline->results_size = s[0].size;
+    }
+    for (size_t b = 0; b < benchmarks_size; b++) {
+      b63_benchmark_report(benchmarks[b], &counters->data[ci], s[b].epochs,
+                           s[b].size);
+    }
+    b63_suite_report_complexity(suite, &counters->data[ci]);
+  }
+  for (size_t i = 0; i < counters->size * benchmarks_size; i++) {
+    free(series[i].epochs);
+  }
+  free(series);
+}
+
+/*
+ * Warns if --scale asks for more threads than there are cpus to pin them
+ * to: threads then share cpus round-robin, and the fit measures the
+ * scheduler rather than the benchmark.
+ */
+static void b63_suite_check_scale(b63_suite *suite) {
+  int8_t scaled = 0;
+  for (size_t i = 0; i < suite->benchmarks_size; i++) {
+    b63_benchmark *family = suite->benchmarks[i]->family;
+    scaled |= family != NULL && b63_benchmark_scaled(family);
+  }
+  if (!scaled) {
+    return;
+  }
+  /* same cpus as b63_mt_cpus picks */
+  int *cpus = suite->cpus;
+  size_t cpus_size = suite->cpus_size;
+  if (cpus == NULL) {
+    cpus_size = b63_cpu_available(&cpus);
+    free(cpus);
+  }
+  for (size_t t = 0; t < suite->scale_size; t++) {
+    if ((size_t)suite->scale[t] > cpus_size) {
+      fprintf(stderr,
+              "--scale: %zu cpus available, above t%zu threads share them "
+              "round-robin and measure oversubscription\n",
+              cpus_size, cpus_size);
+      break;
+    }
+  }
+}
+
+static void b63_suite_run(b63_suite *suite) {
+  b63_suite_collect(suite);
+  b63_benchmark **benchmarks = suite->benchmarks;
+  size_t benchmarks_size = suite->benchmarks_size;
+
+  if (suite->parallel && suite->cpus == NULL) {
+    suite->cpus_size = b63_cpu_available(&suite->cpus);
+    suite->cpus_size = b63_cpu_physical(suite->cpus, suite->cpus_size);
+  }
+  /* aggressors need to know which cpu to stay away from, or to share */
+  if ((suite->deterministic || suite->noise != NULL) && suite->cpus == NULL) {
+    suite->cpus_size = b63_cpu_available(&suite->cpus);
+  }
+  b63_suite_check_scale(suite);
+  if (!suite->parallel && suite->cpus != NULL) {
+    if (!b63_cpu_pin(suite->cpus[0]) && suite->cpus_strict) {
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (suite->noise != NULL) {
+    b63_noise_place(suite->noise, suite->cpus[0]);
+  }
+  if (suite->cache_mode != B63_CACHE_WARM || suite->tlb_cold) {
+    suite->cache = b63_cache_create(suite->cache_mode, suite->tlb_cold);
+  }
+  if (suite->load_size > 0) {
+    suite->load_gaps = (int64_t *)malloc(B63_LOAD_ARRIVALS * sizeof(int64_t));
+    if (suite->load_gaps == NULL) {
+      fprintf(stderr, "memory allocation failed for arrivals\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  for (size_t b = 0; b < benchmarks_size; b++) {
+    if (benchmarks[b]->latency && suite->histogram == NULL) {
+      suite->histogram = (b63_histogram *)malloc(sizeof(b63_histogram));
+      if (suite->histogram == NULL) {
+        fprintf(stderr, "memory allocation failed for histogram\n");
+        exit(EXIT_FAILURE);
+      }
+      if (suite->calibrate) {
+        suite->latency_overhead = b63_latency_calibrate();
+      }
+    }
+  }
+
+  if (suite->budget_s > 0) {
+    b63_suite_run_budget(suite, benchmarks, benchmarks_size);
+    return;
+  }
+
+  /*
+   * In parallel mode all results have to be kept until every benchmark is
+   * done, and they need to be visible to the parent process.
+   * With --precision and a baseline, other benchmarks extend the baseline
+   * with more epochs, so reports are deferred until all of them ran and
+   * the baseline row covers every epoch used in comparisons.
+   */
+  const int64_t max_epochs = b63_suite_max_epochs(suite);
+  int8_t deferred = !suite->parallel && suite->precision > 0.0 &&
+                    suite->baseline != NULL;
+  int8_t keep_all = suite->parallel || deferred;
+  size_t results_size =
+      keep_all ? benchmarks_size * max_epochs : (size_t)max_epochs;
+  size_t sizes_size = keep_all ? benchmarks_size : 1;
+  size_t shared_bytes =
+      results_size * sizeof(b63_epoch) + sizes_size * sizeof(int64_t);
+  b63_epoch *results = (b63_epoch *)mmap(NULL, shared_bytes,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (results == MAP_FAILED) {
+    fprintf(stderr, "memory allocation failed for results\n");
+    exit(EXIT_FAILURE);
+  }
+  int64_t *sizes = (int64_t *)(results + results_size);
+
+  b63_epoch *baseline_results = NULL;
+  if (suite->baseline != NULL && !suite->parallel) {
+    baseline_results = (b63_epoch *)malloc(max_epochs * sizeof(b63_epoch));
+    suite->baseline->results = baseline_results;
+  }
+
+  B63_FOR_EACH_COUNTER(suite->counter_list, counter) {
+    if (counter->type->activate != NULL) {
+      counter->type->activate(counter->impl);
+    }
+    if (suite->calibrate) {
+      b63_calibrate(counter);
+      b63_print_calibration(suite, counter);
+    }
+    if (suite->parallel) {
+      b63_suite_run_parallel(suite, benchmarks, benchmarks_size, counter,
+                             results, sizes);
+      if (suite->baseline != NULL) {
+        suite->baseline->results = results;
+        suite->baseline->results_size = sizes[0];
+      }
+      for (size_t b = 0; b < benchmarks_size; b++) {
+        b63_benchmark_report(benchmarks[b], counter,
+                             results + b * max_epochs, sizes[b]);
+      }
+    } else if (deferred) {
+      for (size_t b = 0; b < benchmarks_size; b++) {
+        b63_benchmark *bm = benchmarks[b];
+        if (bm->is_baseline) {
+          bm->results_size = b63_benchmark_run_epochs(bm, counter,
+                                                      baseline_results);
+        } else {
+          sizes[b] = b63_benchmark_run_epochs(bm, counter,
+                                              results + b * max_epochs);
+        }
+      }
+      for (size_t b = 0; b < benchmarks_size; b++) {
+        b63_benchmark *bm = benchmarks[b];
+        if (bm->is_baseline) {
+          b63_benchmark_finish(bm, counter, baseline_results,
+                               bm->results_size);
+        } else {
+          b63_benchmark_finish(bm, counter, results + b * max_epochs,
+                               sizes[b]);
+        }
+      }
+    } else {
+      for (size_t b = 0; b < benchmarks_size; b++) {
+        b63_benchmark_run(benchmarks[b], counter,
+                          benchmarks[b]->is_baseline ? baseline_results
+                                                     : results);
+      }
+    }
+    b63_suite_report_complexity(suite, counter);
+  }
+  if (suite->deterministic) {
+    b63_print_hash(suite);
+  }
+
+  munmap(results, shared_bytes);
   if (baseline_results != NULL) {
     free(baseline_results);
   }
 }
 
+/*
+ * Default counters for deterministic mode: instruction counts do not depend
+ * on frequency or other processes, unlike time or cycles.
+ */
+#define B63_DETERMINISTIC_COUNTERS                                             \
+  "lpe:instructions:u,lpe:branches,lpe:L1-dcache-loads"
+
 /* Reads config, creates suite and executes it */
 static void b63_go(int argc, char **argv, const char *default_counter) {
   b63_suite suite;
@@ -155,12 +1518,32 @@ static void b63_go(int argc, char **argv, const char *default_counter) {
   b63_suite_init(&suite, argc, argv);
 
   if (suite.counter_list.size == 0) {
-    b63_counter_list_init(&suite.counter_list, default_counter);
+    b63_counter_list_init(&suite.counter_list,
+                          suite.deterministic ? B63_DETERMINISTIC_COUNTERS
+                                              : default_counter);
+    if (suite.counter_list.size == 0) {
+      fprintf(stderr, "no counters initialized; for deterministic mode include "
+                      "counters/perf_events.h or set counters with -c\n");
+      exit(EXIT_FAILURE);
+    }
   }
 
   b63_suite_run(&suite);
 
+  b63_suite_cleanup_benchmarks(&suite);
+  b63_data_cache_clear();
   b63_counter_list_cleanup(&suite.counter_list);
+  free(suite.cpus);
+  free(suite.scale);
+  free(suite.load);
+  free(suite.load_gaps);
+  if (suite.noise != NULL) {
+    free(suite.noise->pool);
+    free(suite.noise);
+  }
+  free(suite.exec);
+  free(suite.histogram);
+  b63_cache_destroy(suite.cache);
 }
 
 /*
@@ -185,48 +1568,6 @@ static void b63_go(int argc, char **argv, const char *default_counter) {
  */
 #define B63_KEEP(v) __asm__ __volatile__("" ::"m"(v))
 
-/*
- * B63_SUSPEND allows to 'exclude' the counted events (or time)
- * from part of the code. It is more convenient way to do set up, for example:
- *
- * B63_BENCHMARK(sort_benchmark, n) {
- *   std::vector<int> a;
- *   B63_SUSPEND { // this block will be excluded
- *     a.resize(n);
- *     std::generate(a.begin(), a.end(), gen); // some random generator
- *   }
- *   std::sort(a.begin(), a.end());
- * }
- */
-
-typedef struct b63_suspension {
-  int64_t start;
-  b63_epoch *run;
-} b63_suspension;
-
-/*
- * This is a callback to execute when suspend context gets out of scope.
- * Total number of events during 'suspension loop' is subtracted from
- * event counter.
- */
-static void b63_suspension_done(b63_suspension *s) {
-  s->run->events -=
-      (s->run->counter->type->read(s->run->counter->impl) - s->start);
-}
-
-/*
- * Use __attribute__((cleanup)) to trigger the measurement when sctx goes out of
- * scope. This allows to compute 'how many events happened during suspension'.
- */
-#define B63_SUSPEND                                                            \
-  b63run->suspension_done = 0;                                                 \
-  for (b63_suspension b63s __attribute__((unused, cleanup(b63_suspension_done))) =     \
-           {                                                                   \
-               .start = b63run->counter->type->read(b63run->counter->impl),    \
-              .run = b63run,                                                   \
-           };                                                                  \
-       b63run->suspension_done == 0; b63run->suspension_done = 1)
-
 #endif
 
 /*
@@ -17,11 +17,17 @@
 #ifndef _B63_CONFIG_H_
 #define _B63_CONFIG_H_
 
+#include <getopt.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 
 #include "benchmark.h"
+#include "cache.h"
+#include "cpu.h"
+#include "io.h"
+#include "latency.h"
+#include "noise.h"
 
 /* Configuration for printing the results. */
 typedef struct b63_printer_config {
@@ -40,8 +46,150 @@ typedef struct b63_suite {
 
   /* global seed for whole suite */
   int64_t seed;
+  int8_t seed_set;
+
+  /*
+   * Deterministic mode: fixed number of iterations per epoch instead of
+   * time limit, instruction-based counters, pinning and fixed seed.
+   * Hash of all results is updated as they are reported.
+   */
+  int8_t deterministic;
+  int64_t iterations;
+  uint64_t hash;
+
+  /* measure and subtract counter overhead, see calibration.h */
+  int8_t calibrate;
+
+  /* cpus to run measurement on, NULL if not pinned */
+  int *cpus;
+  size_t cpus_size;
+  /* cpus come from --cpus, so failing to pin to them is fatal */
+  int8_t cpus_strict;
+  /* run independent benchmarks at the same time, one per cpu */
+  int8_t parallel;
+
+  /*
+   * If > 0, epochs are added until relative half-width of the confidence
+   * interval is below precision (in %), or max_epochs is reached.
+   */
+  double precision;
+  int64_t max_epochs;
+
+  /*
+   * If > 0, total time budget for the whole suite in seconds. Epochs are
+   * given to benchmarks which are furthest from conclusive result.
+   */
+  int64_t budget_s;
+
+  /*
+   * Argument values for parameterized benchmarks in the format
+   * 'a1,a2,...[/b1,b2,...]', overriding ranges from the code. NULL if not set.
+   */
+  const char *args;
+
+  /* latency benchmarks time every latency_sample-th operation */
+  int64_t latency_sample;
+  /* preallocated histogram for latency benchmarks, NULL if none */
+  struct b63_histogram *histogram;
+  /* cost of reading the latency clock, in clock ticks */
+  int64_t latency_overhead;
+
+  /* cache and TLB state before measured batches, see cache.h */
+  int8_t cache_mode;
+  int8_t tlb_cold;
+  b63_cache *cache;
+
+  /*
+   * External commands to benchmark instead of registered benchmarks,
+   * with optional baseline and setup/cleanup commands; see exec.h.
+   */
+  const char **exec;
+  size_t exec_size;
+  const char *exec_baseline;
+  const char *exec_setup, *exec_cleanup;
+
+  /*
+   * Thread counts multithreaded benchmarks are run with instead of their
+   * own, NULL if not set; see mt.h.
+   */
+  int *scale;
+  size_t scale_size;
+
+  /*
+   * Offered loads in operations per second latency benchmarks are run
+   * with in open loop, NULL if not set, arrival process and the table
+   * of gaps between arrivals; see latency.h.
+   */
+  int64_t *load;
+  size_t load_size;
+  int8_t load_arrivals;
+  int64_t *load_gaps;
+
+  /* aggressors running next to benchmarks, NULL if not set; see noise.h */
+  b63_noise *noise;
+
+  /* all benchmarks to run, baseline first, with instances of families */
+  b63_benchmark **benchmarks;
+  size_t benchmarks_size;
 } b63_suite;
 
+/* how many epochs a benchmark might run for at most */
+static int64_t b63_suite_max_epochs(b63_suite *suite) {
+  return suite->precision > 0.0 ? suite->max_epochs : suite->epochs;
+}
+
+/* options which only have a long form get ids outside of char range */
+enum {
+  B63_OPT_NO_CALIBRATION = 256,
+  B63_OPT_CPUS,
+  B63_OPT_PARALLEL,
+  B63_OPT_PRECISION,
+  B63_OPT_MAX_EPOCHS,
+  B63_OPT_BUDGET,
+  B63_OPT_LATENCY_SAMPLE,
+  B63_OPT_CACHE,
+  B63_OPT_TLB,
+  B63_OPT_DETERMINISTIC,
+  B63_OPT_ITERATIONS,
+  B63_OPT_EXEC,
+  B63_OPT_EXEC_BASELINE,
+  B63_OPT_SETUP,
+  B63_OPT_CLEANUP,
+  B63_OPT_SCALE,
+  B63_OPT_NOISE,
+  B63_OPT_NOISE_CPUS,
+  B63_OPT_LOAD,
+  B63_OPT_ARRIVALS,
+  B63_OPT_IO_DIR,
+  B63_OPT_IO_CACHE,
+};
+
+static const struct option b63_long_options[] = {
+    {"no-calibration", no_argument, NULL, B63_OPT_NO_CALIBRATION},
+    {"cpus", required_argument, NULL, B63_OPT_CPUS},
+    {"parallel", no_argument, NULL, B63_OPT_PARALLEL},
+    {"precision", required_argument, NULL, B63_OPT_PRECISION},
+    {"max-epochs", required_argument, NULL, B63_OPT_MAX_EPOCHS},
+    {"budget", required_argument, NULL, B63_OPT_BUDGET},
+    {"latency-sample", required_argument, NULL, B63_OPT_LATENCY_SAMPLE},
+    {"cache", required_argument, NULL, B63_OPT_CACHE},
+    {"tlb", required_argument, NULL, B63_OPT_TLB},
+    {"deterministic", no_argument, NULL, B63_OPT_DETERMINISTIC},
+    {"iterations", required_argument, NULL, B63_OPT_ITERATIONS},
+    {"exec", required_argument, NULL, B63_OPT_EXEC},
+    {"exec-baseline", required_argument, NULL, B63_OPT_EXEC_BASELINE},
+    {"setup", required_argument, NULL, B63_OPT_SETUP},
+    {"cleanup", required_argument, NULL, B63_OPT_CLEANUP},
+    {"scale", required_argument, NULL, B63_OPT_SCALE},
+    {"noise", required_argument, NULL, B63_OPT_NOISE},
+    {"noise-cpus", required_argument, NULL, B63_OPT_NOISE_CPUS},
+    {"load", required_argument, NULL, B63_OPT_LOAD},
+    {"arrivals", required_argument, NULL, B63_OPT_ARRIVALS},
+    {"io-dir", required_argument, NULL, B63_OPT_IO_DIR},
+    {"io-cache", required_argument, NULL, B63_OPT_IO_CACHE},
+    {NULL, 0, NULL, 0},
+};
+
 /*
  * Reads and updates suite from CLI arguments.
  * Might allocate counter, the responsibility to free is on caller
@@ -55,10 +203,75 @@ typedef struct b63_suite {
  * bm_hashmap
  * bm_custom -c calls
  * bm_decision_tree -t 10 -e 5 -i -c lpe:branch-misses
+ * bm_tiny -c time:tsc --no-calibration
+ * bm_hashmap --cpus=2,4,6-8 --parallel
+ * bm_hashmap --precision=0.5 --max-epochs=1000
+ * bm_hashmap --budget=10m
+ * bm_lookup -a 1024,65536
+ * bm_queue --latency-sample=16
+ * bm_hashmap --cache=cold --tlb=cold
+ * bm_hashmap --deterministic --iterations=10000
+ * b63 --exec-baseline='./indexer_old' --exec='./indexer' -c time,os:utime
+ * bm_queue --scale=1,2,4,8,16 -c time,lpe:cache-misses
+ * bm_hashmap --noise=llc-thrash:2,smt-sibling:spin --noise-cpus=4-7
+ * bm_handler --load=10k,20k,50k,100k --arrivals=poisson
+ * bm_io --io-dir=/mnt/nvme --io-cache=cold -c time,os:inblock
  */
 
+/*
+ * Parses list of rates like '1000,20k,1M' into *rates, which needs to be
+ * freed. Returns number of rates, 0 on error.
+ */
+static size_t b63_parse_rates(const char *s, int64_t **rates) {
+  size_t size = 1;
+  for (const char *p = s; *p != '\0'; p++) {
+    size += *p == ',';
+  }
+  *rates = (int64_t *)malloc(size * sizeof(int64_t));
+  if (*rates == NULL) {
+    fprintf(stderr, "memory allocation failed for rates\n");
+    exit(EXIT_FAILURE);
+  }
+  const char *p = s;
+  for (size_t i = 0; i < size; i++) {
+    char *e;
+    double v = strtod(p, &e);
+    if (*e == 'k') {
+      v *= 1e3;
+      e++;
+    } else if (*e == 'M') {
+      v *= 1e6;
+      e++;
+    }
+    if (e == p || (*e != ',' && *e != '\0') || !(v >= 1.0)) {
+      return 0;
+    }
+    (*rates)[i] = (int64_t)v;
+    p = e + 1;
+  }
+  return size;
+}
+
+/* parses durations like '600', '600s', '10m' or '1h' into seconds */
+static int64_t b63_parse_duration_s(const char *s) {
+  char *unit;
+  int64_t res = strtoll(s, &unit, 10);
+  switch (*unit) {
+  case 'h':
+    return res * 3600;
+  case 'm':
+    return res * 60;
+  case 's':
+  case '\0':
+    return res;
+  }
+  return 0;
+}
+
 static void b63_suite_init(b63_suite *suite, int argc, char **argv) {
   int c;
+  const char *counters = NULL;
+  const char *noise_cpus = NULL;
 
   /* default values */
   suite->timelimit_s = 1;
@@ -68,9 +281,72 @@ static void b63_suite_init(b63_suite *suite, int argc, char **argv) {
   suite->baseline = NULL;
   suite->printer_config.plaintext = 1;
   suite->printer_config.delimiter = ',';
+  suite->seed_set = 0;
+  suite->deterministic = 0;
+  suite->iterations = 1024;
+  suite->hash = 14695981039346656037ULL;
+  suite->calibrate = 1;
+  suite->cpus = NULL;
+  suite->cpus_size = 0;
+  suite->cpus_strict = 0;
+  suite->parallel = 0;
+  suite->precision = 0.0;
+  suite->max_epochs = 0;
+  suite->budget_s = 0;
+  suite->args = NULL;
+  suite->latency_sample = 1;
+  suite->histogram = NULL;
+  suite->latency_overhead = 0;
+  suite->cache_mode = B63_CACHE_WARM;
+  suite->tlb_cold = 0;
+  suite->cache = NULL;
+  suite->exec = NULL;
+  suite->exec_size = 0;
+  suite->exec_baseline = NULL;
+  suite->exec_setup = NULL;
+  suite->exec_cleanup = NULL;
+  suite->scale = NULL;
+  suite->scale_size = 0;
+  suite->noise = NULL;
+  suite->load = NULL;
+  suite->load_size = 0;
+  suite->load_arrivals = B63_ARRIVALS_POISSON;
+  suite->load_gaps = NULL;
+  suite->benchmarks = NULL;
+  suite->benchmarks_size = 0;
 
-  while ((c = getopt(argc, argv, "it:e:c:d:s:")) != -1) {
+  while ((c = getopt_long(argc, argv, "it:e:c:d:s:a:", b63_long_options,
+                          NULL)) != -1) {
     switch (c) {
+    case B63_OPT_NO_CALIBRATION:
+      suite->calibrate = 0;
+      break;
+    case B63_OPT_CPUS:
+      free(suite->cpus);
+      suite->cpus_size = b63_cpu_list_parse(optarg, &suite->cpus);
+      if (suite->cpus_size == 0) {
+        fprintf(stderr, "unable to parse cpu list: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      suite->cpus_strict = 1;
+      break;
+    case B63_OPT_PARALLEL:
+      suite->parallel = 1;
+      break;
+    case B63_OPT_PRECISION:
+      suite->precision = atof(optarg);
+      if (!(suite->precision > 0.0)) {
+        fprintf(stderr, "precision must be > 0\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_MAX_EPOCHS:
+      suite->max_epochs = atoi(optarg);
+      if (!(suite->max_epochs > 1)) {
+        fprintf(stderr, "max epochs count must be > 1\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
     case 'i':
       suite->printer_config.plaintext = 0;
       break;
@@ -80,6 +356,10 @@ static void b63_suite_init(b63_suite *suite, int argc, char **argv) {
       break;
     case 's':
       suite->seed = strtoll(optarg, NULL, 10);
+      suite->seed_set = 1;
+      break;
+    case 'a':
+      suite->args = optarg;
       break;
     case 't':
       suite->timelimit_s = atoi(optarg);
@@ -92,13 +372,185 @@ static void b63_suite_init(b63_suite *suite, int argc, char **argv) {
       }
       break;
     case 'c':
-      b63_counter_list_init(&suite->counter_list, optarg);
-      if (suite->counter_list.size == 0) {
-        fprintf(stderr, "counter_list unable to init: %s\n", optarg);
+      /* created after all options are known, see below */
+      counters = optarg;
+      break; /* from switch */
+    case B63_OPT_EXEC:
+      suite->exec = (const char **)realloc(
+          suite->exec, (suite->exec_size + 1) * sizeof(const char *));
+      if (suite->exec == NULL) {
+        fprintf(stderr, "memory allocation failed for commands\n");
         exit(EXIT_FAILURE);
       }
-      break; /* from switch */
+      suite->exec[suite->exec_size++] = optarg;
+      break;
+    case B63_OPT_EXEC_BASELINE:
+      suite->exec_baseline = optarg;
+      break;
+    case B63_OPT_SETUP:
+      suite->exec_setup = optarg;
+      break;
+    case B63_OPT_CLEANUP:
+      suite->exec_cleanup = optarg;
+      break;
+    case B63_OPT_SCALE:
+      /* same format as cpu list: 1,2,4 or 1-8 */
+      free(suite->scale);
+      suite->scale_size = b63_cpu_list_parse(optarg, &suite->scale);
+      if (suite->scale_size == 0) {
+        fprintf(stderr, "unable to parse thread counts: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      for (size_t i = 0; i < suite->scale_size; i++) {
+        if (suite->scale[i] < 1) {
+          fprintf(stderr, "thread count must be > 0: %s\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+      }
+      break;
+    case B63_OPT_NOISE:
+      free(suite->noise);
+      suite->noise = (b63_noise *)malloc(sizeof(b63_noise));
+      if (suite->noise == NULL) {
+        fprintf(stderr, "memory allocation failed for noise\n");
+        exit(EXIT_FAILURE);
+      }
+      if (!b63_noise_parse(suite->noise, optarg)) {
+        fprintf(stderr,
+                "noise must be a list of kind:count or smt-sibling:kind, "
+                "kinds are spin, llc-thrash, membw, branch-storm: %s\n",
+                optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_NOISE_CPUS:
+      noise_cpus = optarg;
+      break;
+    case B63_OPT_LOAD:
+      free(suite->load);
+      suite->load_size = b63_parse_rates(optarg, &suite->load);
+      if (suite->load_size == 0) {
+        fprintf(stderr, "load must be a list of ops/s, for example "
+                        "1000,20k,1M: %s\n",
+                optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_ARRIVALS:
+      if (strcmp(optarg, "poisson") == 0) {
+        suite->load_arrivals = B63_ARRIVALS_POISSON;
+      } else if (strcmp(optarg, "constant") == 0) {
+        suite->load_arrivals = B63_ARRIVALS_CONSTANT;
+      } else {
+        fprintf(stderr, "arrivals must be poisson or constant: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_IO_DIR:
+      b63_io_dir = optarg;
+      break;
+    case B63_OPT_IO_CACHE:
+      if (strcmp(optarg, "cold") == 0) {
+        b63_io_cold = 1;
+      } else if (strcmp(optarg, "warm") == 0) {
+        b63_io_cold = 0;
+      } else {
+        fprintf(stderr, "io-cache must be cold or warm: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_BUDGET:
+      suite->budget_s = b63_parse_duration_s(optarg);
+      if (!(suite->budget_s > 0)) {
+        fprintf(stderr, "budget must be > 0: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_CACHE:
+      if (strcmp(optarg, "warm") == 0) {
+        suite->cache_mode = B63_CACHE_WARM;
+      } else if (strcmp(optarg, "cold") == 0) {
+        suite->cache_mode = B63_CACHE_COLD;
+      } else if (strcmp(optarg, "llc-only") == 0) {
+        suite->cache_mode = B63_CACHE_LLC_ONLY;
+      } else {
+        fprintf(stderr, "cache mode must be cold, warm or llc-only: %s\n",
+                optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_TLB:
+      if (strcmp(optarg, "cold") == 0) {
+        suite->tlb_cold = 1;
+      } else if (strcmp(optarg, "warm") == 0) {
+        suite->tlb_cold = 0;
+      } else {
+        fprintf(stderr, "tlb mode must be cold or warm: %s\n", optarg);
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_DETERMINISTIC:
+      suite->deterministic = 1;
+      break;
+    case B63_OPT_ITERATIONS:
+      suite->iterations = atoll(optarg);
+      if (!(suite->iterations > 0)) {
+        fprintf(stderr, "iterations count must be > 0\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case B63_OPT_LATENCY_SAMPLE:
+      suite->latency_sample = atoll(optarg);
+      if (!(suite->latency_sample > 0)) {
+        fprintf(stderr, "latency sample must be > 0\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    }
+  }
+  if (suite->max_epochs == 0) {
+    suite->max_epochs = 10 * suite->epochs;
+  }
+  /* external commands are counted from the parent process */
+  if (suite->exec_size > 0 || suite->exec_baseline != NULL) {
+    b63_counter_inherit = 1;
+  }
+  if (noise_cpus != NULL && suite->noise != NULL) {
+    suite->noise->pool_size =
+        b63_cpu_list_parse(noise_cpus, &suite->noise->pool);
+    if (suite->noise->pool_size == 0) {
+      fprintf(stderr, "unable to parse noise cpu list: %s\n", noise_cpus);
+      exit(EXIT_FAILURE);
+    }
+  }
+  /* quiet and noisy runs are compared epoch by epoch */
+  if (suite->noise != NULL) {
+    if (suite->budget_s > 0) {
+      fprintf(stderr, "--noise is not supported with --budget\n");
+      exit(EXIT_FAILURE);
+    }
+    suite->parallel = 0;
+  }
+  /* threads need the whole machine, not one cpu per benchmark */
+  if (suite->scale_size > 0) {
+    suite->parallel = 0;
+  }
+  if (counters != NULL) {
+    b63_counter_list_init(&suite->counter_list, counters);
+    if (suite->counter_list.size == 0) {
+      fprintf(stderr, "counter_list unable to init: %s\n", counters);
+      exit(EXIT_FAILURE);
+    }
+  }
+  /* nothing which depends on time or measured overhead */
+  if (suite->deterministic) {
+    if (!suite->seed_set) {
+      suite->seed = 0;
     }
+    suite->calibrate = 0;
+    suite->precision = 0.0;
+    suite->budget_s = 0;
+    suite->parallel = 0;
   }
 }
 
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_SUSPEND_H_
+#define _B63_SUSPEND_H_
+
+#include "benchmark.h"
+#include "counter.h"
+
+/*
+ * B63_SUSPEND allows to 'exclude' the counted events (or time)
+ * from part of the code. It is more convenient way to do set up, for example:
+ *
+ * B63_BENCHMARK(sort_benchmark, n) {
+ *   std::vector<int> a;
+ *   B63_SUSPEND { // this block will be excluded
+ *     a.resize(n);
+ *     std::generate(a.begin(), a.end(), gen); // some random generator
+ *   }
+ *   std::sort(a.begin(), a.end());
+ * }
+ */
+
+typedef struct b63_suspension {
+  int64_t start;
+  b63_epoch *run;
+} b63_suspension;
+
+/*
+ * This is a callback to execute when suspend context gets out of scope.
+ * Total number of events during 'suspension loop' is subtracted from
+ * event counter, together with calibrated cost of suspension itself.
+ * Current phase gets the same correction.
+ */
+static void b63_suspension_done(b63_suspension *s) {
+  b63_counter *c = s->run->counter;
+  int64_t suspended =
+      (c->type->read(c->impl) - s->start) + c->calibration.suspension;
+  s->run->events -= suspended;
+  s->run->phase_events[s->run->phase] -= suspended;
+}
+
+/*
+ * Use __attribute__((cleanup)) to trigger the measurement when sctx goes out of
+ * scope. This allows to compute 'how many events happened during suspension'.
+ */
+#define B63_SUSPEND                                                            \
+  b63run->suspension_done = 0;                                                 \
+  for (b63_suspension b63s __attribute__((unused, cleanup(b63_suspension_done))) =     \
+           {                                                                   \
+               .start = b63run->counter->type->read(b63run->counter->impl),    \
+              .run = b63run,                                                   \
+           };                                                                  \
+       b63run->suspension_done == 0; b63run->suspension_done = 1)
+
+#endif
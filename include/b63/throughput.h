@@ -0,0 +1,84 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_THROUGHPUT_H_
+#define _B63_THROUGHPUT_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "benchmark.h"
+#include "counter.h"
+
+/*
+ * Throughput: benchmark declares how many bytes and/or items one iteration
+ * processes, and results are reported as amount per counter event as well:
+ *
+ * B63_BENCHMARK(hash, n) {
+ *   B63_SET_BYTES(b63run, kBufferSize);
+ *   for (int i = 0; i < n; i++) { ... hash kBufferSize bytes ... }
+ * }
+ *
+ * With time counter this is GB/s (bytes per ns) and M items/s; with any
+ * other counter it's amount per event, for example bytes per cache miss.
+ */
+#define B63_SET_BYTES(run, bytes_per_iteration)                                \
+  ((run)->bytes = (bytes_per_iteration))
+#define B63_SET_ITEMS(run, items_per_iteration)                                \
+  ((run)->items = (items_per_iteration))
+
+enum { B63_THROUGHPUT_BYTES = 0, B63_THROUGHPUT_ITEMS, B63_THROUGHPUT_KINDS };
+
+static const char *b63_throughput_names[B63_THROUGHPUT_KINDS] = {"bytes",
+                                                                  "items"};
+
+static int64_t b63_throughput_amount(b63_epoch *e, int kind) {
+  return kind == B63_THROUGHPUT_BYTES ? e->bytes : e->items;
+}
+
+static int8_t b63_throughput_is_time(b63_counter *c) {
+  return strcmp(c->type->prefix, "time") == 0;
+}
+
+/* amount processed per counter event, not scaled */
+static double b63_throughput_raw(b63_epoch *e, int kind) {
+  if (e->events <= 0) {
+    return 0.0;
+  }
+  return 1.0 * b63_throughput_amount(e, kind) * e->iterations / e->events;
+}
+
+/* same, in units from b63_throughput_unit */
+static double b63_throughput(b63_epoch *e, int kind) {
+  double v = b63_throughput_raw(e, kind);
+  if (b63_throughput_is_time(e->counter) && kind == B63_THROUGHPUT_ITEMS) {
+    v *= 1000.0;
+  }
+  return v;
+}
+
+static void b63_throughput_unit(b63_counter *c, int kind, char *buf,
+                                size_t size) {
+  if (b63_throughput_is_time(c)) {
+    snprintf(buf, size, "%s", kind == B63_THROUGHPUT_BYTES ? "GB/s" : "M/s");
+  } else {
+    snprintf(buf, size, "%s/%s", kind == B63_THROUGHPUT_BYTES ? "B" : "items",
+             c->name);
+  }
+}
+
+#endif
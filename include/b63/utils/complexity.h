@@ -0,0 +1,89 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_UTILS_COMPLEXITY_H_
+#define _B63_UTILS_COMPLEXITY_H_
+
+#include <math.h>
+#include <stddef.h>
+
+/*
+ * Fitting of asymptotic complexity for parameterized benchmarks.
+ * For each model f, coefficient c minimizing sum ((y - c * f(n)) / y)^2 is
+ * computed, and the model with smallest root mean square error wins.
+ * Errors are relative, as y usually spans several orders of magnitude and
+ * absolute errors would only take the largest arguments into account.
+ */
+
+#define B63_COMPLEXITY_MODELS 5
+
+static const char *b63_complexity_names[B63_COMPLEXITY_MODELS] = {
+    "O(1)", "O(log N)", "O(N)", "O(N log N)", "O(N^2)",
+};
+
+static double b63_complexity_f(int model, double n) {
+  switch (model) {
+  case 0:
+    return 1.0;
+  case 1:
+    return log2(n);
+  case 2:
+    return n;
+  case 3:
+    return n * log2(n);
+  default:
+    return n * n;
+  }
+}
+
+/*
+ * Returns index of the best model, -1 if none could be fit;
+ * coefficient and relative RMS error are written to coef and rms.
+ */
+static int b63_complexity_fit(const double *n, const double *y, size_t size,
+                              double *coef, double *rms) {
+  int best = -1;
+  for (size_t i = 0; i < size; i++) {
+    if (!(y[i] > 0.0)) {
+      return -1;
+    }
+  }
+  for (int m = 0; m < B63_COMPLEXITY_MODELS; m++) {
+    double fy = 0.0, ff = 0.0, err = 0.0;
+    for (size_t i = 0; i < size; i++) {
+      double f = b63_complexity_f(m, n[i]) / y[i];
+      fy += f;
+      ff += f * f;
+    }
+    if (ff == 0.0) {
+      continue;
+    }
+    double c = fy / ff;
+    for (size_t i = 0; i < size; i++) {
+      double d = 1.0 - c * b63_complexity_f(m, n[i]) / y[i];
+      err += d * d;
+    }
+    err = sqrt(err / size);
+    if (best == -1 || err < *rms) {
+      best = m;
+      *coef = c;
+      *rms = err;
+    }
+  }
+  return best;
+}
+
+#endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_UTILS_HISTOGRAM_H_
+#define _B63_UTILS_HISTOGRAM_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Log-linear (HDR-style) histogram of non-negative integer values.
+ * Values below 2^B63_HISTOGRAM_SUB_BITS are counted exactly; above that,
+ * every power of two range is split into 2^(B63_HISTOGRAM_SUB_BITS - 1)
+ * linear buckets, so relative error of a recorded value is below
+ * 2^-(B63_HISTOGRAM_SUB_BITS - 1), ~0.8%. Storage is fixed, so recording a
+ * value never allocates.
+ */
+#define B63_HISTOGRAM_SUB_BITS 8
+#define B63_HISTOGRAM_SUB (1LL << B63_HISTOGRAM_SUB_BITS)
+#define B63_HISTOGRAM_BUCKETS                                                  \
+  (B63_HISTOGRAM_SUB + (64 - B63_HISTOGRAM_SUB_BITS) * (B63_HISTOGRAM_SUB / 2))
+
+typedef struct b63_histogram {
+  int64_t counts[B63_HISTOGRAM_BUCKETS];
+  int64_t total;
+  int64_t max;
+} b63_histogram;
+
+static void b63_histogram_reset(b63_histogram *h) {
+  memset(h, 0, sizeof(b63_histogram));
+}
+
+static inline int64_t b63_histogram_bucket(uint64_t v) {
+  if (v < (uint64_t)B63_HISTOGRAM_SUB) {
+    return v;
+  }
+  int shift = 63 - __builtin_clzll(v) - (B63_HISTOGRAM_SUB_BITS - 1);
+  return B63_HISTOGRAM_SUB + (shift - 1) * (B63_HISTOGRAM_SUB / 2) +
+         (v >> shift) - B63_HISTOGRAM_SUB / 2;
+}
+
+static inline void b63_histogram_add(b63_histogram *h, int64_t v) {
+  if (v < 0) {
+    v = 0;
+  }
+  h->counts[b63_histogram_bucket(v)]++;
+  h->total++;
+  if (v > h->max) {
+    h->max = v;
+  }
+}
+
+/* middle of the value range covered by bucket i */
+static double b63_histogram_value(int64_t i) {
+  if (i < B63_HISTOGRAM_SUB) {
+    return i;
+  }
+  int64_t shift = (i - B63_HISTOGRAM_SUB) / (B63_HISTOGRAM_SUB / 2) + 1;
+  int64_t top = (i - B63_HISTOGRAM_SUB) % (B63_HISTOGRAM_SUB / 2) +
+                B63_HISTOGRAM_SUB / 2;
+  return (double)(top << shift) + (double)((1LL << shift) - 1) / 2.0;
+}
+
+/*
+ * Value at quantile q (0 < q <= 1), that is, the smallest recorded value
+ * with at least q * total values <= it. Exact for q = 1.
+ */
+static double b63_histogram_quantile(b63_histogram *h, double q) {
+  if (h->total == 0) {
+    return 0.0;
+  }
+  int64_t rank = (int64_t)(q * h->total + 0.5);
+  rank = rank < 1 ? 1 : rank;
+  if (rank >= h->total) {
+    return h->max;
+  }
+  int64_t seen = 0;
+  for (int64_t i = 0; i < B63_HISTOGRAM_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen >= rank) {
+      double v = b63_histogram_value(i);
+      return v < h->max ? v : h->max;
+    }
+  }
+  return h->max;
+}
+
+#endif
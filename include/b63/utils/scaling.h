@@ -0,0 +1,108 @@
+/*
+ * Copyright 2019 Oleksandr Kuvshynov
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _B63_UTILS_SCALING_H_
+#define _B63_UTILS_SCALING_H_
+
+#include <math.h>
+#include <stddef.h>
+
+/*
+ * Scalability models for speedup C(N) at relative concurrency N:
+ *
+ *   Amdahl: C(N) = N / (1 + sigma (N - 1))
+ *   USL:    C(N) = N / (1 + sigma (N - 1) + kappa N (N - 1))
+ *
+ * sigma is contention (serialized fraction), kappa is coherency (cost of
+ * keeping shared state consistent, which makes throughput go down after
+ * the peak at sqrt((1 - sigma) / kappa)). Both are linear after
+ * N / C(N) - 1 = sigma x + kappa N x, where x = N - 1, and are fit with
+ * least squares on that form, with coefficients kept non-negative. Points
+ * with N = 1 carry no information.
+ */
+
+typedef struct b63_scaling {
+  double amdahl_sigma, amdahl_rms;
+  double sigma, kappa, rms;
+  /* 0 if the USL fit is not available */
+  int usl;
+} b63_scaling;
+
+/* relative rms error of predicted speedup */
+static double b63_scaling_rms(const double *n, const double *c, size_t size,
+                              double sigma, double kappa) {
+  double err = 0.0;
+  for (size_t i = 0; i < size; i++) {
+    double p = n[i] / (1.0 + sigma * (n[i] - 1.0) + kappa * n[i] * (n[i] - 1.0));
+    double d = 1.0 - p / c[i];
+    err += d * d;
+  }
+  return sqrt(err / size);
+}
+
+/* returns 0 if there are not enough points with N > 1 */
+static int b63_scaling_fit(const double *n, const double *c, size_t size,
+                           b63_scaling *res) {
+  double xx = 0.0, xy = 0.0, nxx = 0.0, nnxx = 0.0, nxy = 0.0;
+  size_t points = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (!(c[i] > 0.0)) {
+      return 0;
+    }
+    if (n[i] <= 1.0) {
+      continue;
+    }
+    double x = n[i] - 1.0, y = n[i] / c[i] - 1.0;
+    xx += x * x;
+    xy += x * y;
+    nxx += n[i] * x * x;
+    nnxx += n[i] * n[i] * x * x;
+    nxy += n[i] * x * y;
+    points++;
+  }
+  if (points == 0) {
+    return 0;
+  }
+  res->amdahl_sigma = xy > 0.0 ? xy / xx : 0.0;
+  res->amdahl_rms = b63_scaling_rms(n, c, size, res->amdahl_sigma, 0.0);
+
+  double det = xx * nnxx - nxx * nxx;
+  res->usl = points >= 2 && fabs(det) > 1e-12 * xx * nnxx;
+  if (res->usl) {
+    res->sigma = (xy * nnxx - nxx * nxy) / det;
+    res->kappa = (xx * nxy - nxx * xy) / det;
+    /* negative coefficient has no meaning, fit the other one alone */
+    if (res->sigma < 0.0) {
+      res->sigma = 0.0;
+      res->kappa = nxy > 0.0 ? nxy / nnxx : 0.0;
+    } else if (res->kappa < 0.0) {
+      res->sigma = res->amdahl_sigma;
+      res->kappa = 0.0;
+    }
+    res->rms = b63_scaling_rms(n, c, size, res->sigma, res->kappa);
+  }
+  return 1;
+}
+
+/* relative concurrency with highest throughput, 0 if unbounded */
+static double b63_scaling_peak(const b63_scaling *s) {
+  if (!s->usl || !(s->kappa > 0.0) || s->sigma >= 1.0) {
+    return 0.0;
+  }
+  return sqrt((1.0 - s->sigma) / s->kappa);
+}
+
+#endif
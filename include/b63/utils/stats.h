@@ -32,6 +32,8 @@ typedef struct b63_stats {
   double sum_base, sum_test;
   double sum;
   double sum_squared;
+  /* significance level for confidence interval, 0.01 by default */
+  double alpha;
 } b63_stats;
 
 /*
@@ -43,6 +45,7 @@ void b63_stats_init(b63_stats *stats) {
   stats->sum_base = 0.0;
   stats->sum_test = 0.0;
   stats->sum_squared = 0.0;
+  stats->alpha = 0.01;
 }
 
 /*
@@ -80,6 +83,97 @@ double b63_stats_99_interval(b63_stats *stats) {
   return sqrt((ssq - s * s / n) / (n * (n - 1))) * val;
 }
 
+/*
+ * Regularized incomplete beta function I_x(a, b), evaluated with continued
+ * fraction (modified Lentz's method). Needed for Student's t distribution.
+ */
+static double b63_stats_betacf(double a, double b, double x) {
+  const double eps = 1e-12, tiny = 1e-300;
+  double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+  if (fabs(d) < tiny) {
+    d = tiny;
+  }
+  d = 1.0 / d;
+  double h = d;
+  for (int m = 1; m <= 300; m++) {
+    int m2 = 2 * m;
+    double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+    d = 1.0 + aa * d;
+    d = fabs(d) < tiny ? tiny : d;
+    c = 1.0 + aa / c;
+    c = fabs(c) < tiny ? tiny : c;
+    d = 1.0 / d;
+    h *= d * c;
+    aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+    d = 1.0 + aa * d;
+    d = fabs(d) < tiny ? tiny : d;
+    c = 1.0 + aa / c;
+    c = fabs(c) < tiny ? tiny : c;
+    d = 1.0 / d;
+    double del = d * c;
+    h *= del;
+    if (fabs(del - 1.0) < eps) {
+      break;
+    }
+  }
+  return h;
+}
+
+static double b63_stats_ibeta(double a, double b, double x) {
+  if (x <= 0.0) {
+    return 0.0;
+  }
+  if (x >= 1.0) {
+    return 1.0;
+  }
+  double bt = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) +
+                  b * log(1.0 - x));
+  if (x < (a + 1.0) / (a + b + 2.0)) {
+    return bt * b63_stats_betacf(a, b, x) / a;
+  }
+  return 1.0 - bt * b63_stats_betacf(b, a, 1.0 - x) / b;
+}
+
+/* two-sided tail probability P(|T| > t) for Student's t with df degrees */
+static double b63_stats_t_tail(double t, double df) {
+  return b63_stats_ibeta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+/*
+ * Critical value t such that P(|T| > t) = alpha, found by bisection.
+ * ttable.h has precomputed values for alpha = 0.01 only.
+ */
+static double b63_stats_t_critical(double alpha, double df) {
+  double lo = 0.0, hi = 1.0;
+  while (b63_stats_t_tail(hi, df) > alpha) {
+    hi *= 2.0;
+  }
+  for (int i = 0; i < 100 && hi - lo > 1e-9; i++) {
+    double mid = (lo + hi) / 2.0;
+    if (b63_stats_t_tail(mid, df) > alpha) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return (lo + hi) / 2.0;
+}
+
+/*
+ * Confidence interval half-width with significance level stats->alpha.
+ * For default alpha this is the same as b63_stats_99_interval.
+ */
+double b63_stats_interval(b63_stats *stats) {
+  if (stats->alpha == 0.01) {
+    return b63_stats_99_interval(stats);
+  }
+  double n = stats->n;
+  double s = stats->sum;
+  double ssq = stats->sum_squared;
+  return sqrt((ssq - s * s / n) / (n * (n - 1))) *
+         b63_stats_t_critical(stats->alpha, n - 1);
+}
+
 /*
  * compute paired t-test values. Unused at the moment.
  */
@@ -22,6 +22,8 @@
 #include <time.h>
 #endif
 
+#include <stdint.h>
+
 /*
  * This is used NOT for benchmarking itself, but to track
  * time passed and control the number of iterations.
@@ -43,4 +45,62 @@ int64_t b63_now_ms() {
 #endif
 }
 
+/* Same as above, in nanoseconds */
+static int64_t b63_monotonic_ns() {
+#ifdef NO_GET_TIME_SUPPORTED
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return 1000000000LL * tv.tv_sec + 1000LL * tv.tv_usec;
+#else
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return 1000000000LL * (int64_t)t.tv_sec + t.tv_nsec;
+#endif
+}
+
+/*
+ * Time stamp counter support. TSC is the cheapest clock to read on x86,
+ * but it counts ticks, not nanoseconds, so the tick length is estimated
+ * once against CLOCK_MONOTONIC. Only meaningful on CPUs with invariant TSC.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(NO_GET_TIME_SUPPORTED)
+#define B63_TSC_SUPPORTED 1
+
+static inline uint64_t b63_tsc_read() {
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/*
+ * rdtsc is not ordered with surrounding instructions, so a short operation
+ * can appear to take less than the reads around it. Fences keep the read
+ * after everything before it, and everything after it after the read.
+ */
+static inline uint64_t b63_tsc_read_ordered() {
+  uint32_t lo, hi;
+  __asm__ __volatile__("lfence\n\trdtsc\n\tlfence"
+                       : "=a"(lo), "=d"(hi)
+                       :
+                       : "memory");
+  return ((uint64_t)hi << 32) | lo;
+}
+
+/* nanoseconds per TSC tick; computed on first call, ~20ms busy wait. */
+static double b63_tsc_ns_per_tick() {
+  static double ns_per_tick = 0.0;
+  if (ns_per_tick == 0.0) {
+    int64_t ns_started = b63_monotonic_ns();
+    uint64_t tsc_started = b63_tsc_read();
+    int64_t ns_done;
+    do {
+      ns_done = b63_monotonic_ns();
+    } while (ns_done - ns_started < 20000000LL);
+    uint64_t tsc_done = b63_tsc_read();
+    ns_per_tick = 1.0 * (ns_done - ns_started) / (tsc_done - tsc_started);
+  }
+  return ns_per_tick;
+}
+#endif
+
 #endif